@@ -0,0 +1,216 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_BARRIER_LIBRARY_H
+#define FLUENT_LIBC_BARRIER_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// barrier_t API
+// ----------------------------------------
+// Reusable, phase-based barrier for a fixed set of participants.
+//
+// Participants are grouped into a combining tree with BARRIER_FANIN
+// slots per node, each node on its own cache line. An arriving thread
+// only touches its leaf; the last arriver at a node climbs to the
+// parent, and the last arriver at the root ends the phase. Release
+// travels back down the same path, so every node wakes only its own
+// waiters and wake-ups proceed in parallel down the tree. Waiters spin
+// briefly, then sleep on their node's phase word (futex on Linux, the
+// parking lot elsewhere).
+// ----------------------------------------
+// Features:
+// - barrier_init:     Initialize a barrier for n participants.
+// - barrier_wait:     Arrive and wait for the other participants.
+// - barrier_destroy:  Release barrier resources.
+//
+// Function Signatures:
+// ----------------------------------------
+// int barrier_init(barrier_t *b, uint32_t participants);
+//     Example:
+//         barrier_t b;
+//         barrier_init(&b, 64);
+//
+// int barrier_wait(barrier_t *b, uint32_t id);
+//     Example:
+//         // id is the caller's participant index in [0, participants)
+//         if (barrier_wait(&b, worker_index)) { ... serial step ... }
+//
+// void barrier_destroy(barrier_t *b);
+//     Example:
+//         barrier_destroy(&b);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: wait.h
+// ----------------------------------------
+
+#include <errno.h>
+#include <stdlib.h>
+#include "parking_lot.h"
+#include "wait.h"
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Arrivals combined per tree node.
+ */
+#ifndef BARRIER_FANIN
+#   define BARRIER_FANIN 4u
+#endif
+
+/**
+ * @brief Pause-spins a waiter does before sleeping.
+ */
+#ifndef BARRIER_SPIN_LIMIT
+#   define BARRIER_SPIN_LIMIT 1000
+#endif
+
+/**
+ * @brief Node of the combining tree, padded to a cache line.
+ */
+typedef union {
+    struct {
+        uint32_t arrived;   /**< Arrivals in the current phase */
+        uint32_t expected;  /**< Arrivals that complete this node */
+        uint32_t phase;     /**< Bumped when the node's waiters are released */
+        uint32_t sleepers;  /**< Waiters that may be asleep on `phase` */
+        uint32_t parent;    /**< Index of the parent node, UINT32_MAX at the root */
+    } n;
+    char pad[64];
+} barrier_node_t;
+
+/**
+ * @brief Reusable combining-tree barrier.
+ */
+typedef struct {
+    barrier_node_t *nodes;  /**< Leaves first, root last */
+    uint32_t participants;  /**< Threads per phase */
+} barrier_t;
+
+/**
+ * @brief Initializes the barrier.
+ *
+ * @param b Pointer to the barrier_t structure to initialize.
+ * @param participants Number of threads that must arrive each phase.
+ * @return 0 on success, EINVAL for zero participants, ENOMEM on allocation failure.
+ */
+static inline int barrier_init(barrier_t *b, const uint32_t participants) {
+    if (participants == 0) {
+        return EINVAL;
+    }
+
+    // Count the nodes of every level
+    uint32_t total = 0;
+    for (uint32_t width = participants; ; width = (width + BARRIER_FANIN - 1) / BARRIER_FANIN) {
+        const uint32_t level = (width + BARRIER_FANIN - 1) / BARRIER_FANIN;
+        total += level;
+        if (level == 1) {
+            break;
+        }
+    }
+
+    b->nodes = (barrier_node_t *) calloc(total, sizeof(barrier_node_t));
+    if (!b->nodes) {
+        return ENOMEM;
+    }
+    b->participants = participants;
+
+    // Lay out level by level; a level's children are the previous level
+    uint32_t first = 0;
+    uint32_t width = participants;
+    for (;;) {
+        const uint32_t level = (width + BARRIER_FANIN - 1) / BARRIER_FANIN;
+        for (uint32_t i = 0; i < level; i++) {
+            barrier_node_t *node = &b->nodes[first + i];
+            const uint32_t remaining = width - i * BARRIER_FANIN;
+            node->n.expected = remaining < BARRIER_FANIN ? remaining : BARRIER_FANIN;
+            node->n.parent = level == 1 ? UINT32_MAX : first + level + i / BARRIER_FANIN;
+        }
+        if (level == 1) {
+            break;
+        }
+        first += level;
+        width = level;
+    }
+    return 0;
+}
+
+/**
+ * @brief Arrives at a node and waits for its release.
+ *
+ * @return 1 for the single thread that completed the root, 0 otherwise.
+ */
+static inline int barrier_arrive(barrier_t *b, const uint32_t index) {
+    barrier_node_t *node = &b->nodes[index];
+    // Sample the phase before arriving so a release cannot be missed
+    const uint32_t phase = __atomic_load_n(&node->n.phase, __ATOMIC_ACQUIRE);
+
+    if (__atomic_add_fetch(&node->n.arrived, 1, __ATOMIC_ACQ_REL) == node->n.expected) {
+        // Last here: reset for the next phase, combine upwards, then release
+        __atomic_store_n(&node->n.arrived, 0, __ATOMIC_RELAXED);
+        const int serial = node->n.parent == UINT32_MAX ? 1 : barrier_arrive(b, node->n.parent);
+
+        __atomic_add_fetch(&node->n.phase, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&node->n.sleepers, __ATOMIC_SEQ_CST) != 0) {
+            wake_all(&node->n.phase);
+        }
+        return serial;
+    }
+
+    for (int i = 0; i < BARRIER_SPIN_LIMIT; i++) {
+        if (__atomic_load_n(&node->n.phase, __ATOMIC_ACQUIRE) != phase) {
+            return 0;
+        }
+        mutex_cpu_relax();
+    }
+
+    __atomic_add_fetch(&node->n.sleepers, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&node->n.phase, __ATOMIC_SEQ_CST) == phase) {
+        wait_on_address(&node->n.phase, phase, PARKING_LOT_FOREVER);
+    }
+    __atomic_sub_fetch(&node->n.sleepers, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return 0;
+}
+
+/**
+ * @brief Arrives at the barrier and waits for the rest of the phase.
+ *
+ * Each participant must pass a distinct id, stable across phases.
+ *
+ * @param b Pointer to the barrier_t structure.
+ * @param id The caller's participant index, in [0, participants).
+ * @return 1 for exactly one participant per phase (the "serial" thread), 0 for the others.
+ */
+static inline int barrier_wait(barrier_t *b, const uint32_t id) {
+    return barrier_arrive(b, id / BARRIER_FANIN);
+}
+
+/**
+ * @brief Destroys the barrier.
+ *
+ * @param b Pointer to the barrier_t structure to destroy.
+ */
+static inline void barrier_destroy(barrier_t *b) {
+    free(b->nodes);
+    b->nodes = NULL;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_BARRIER_LIBRARY_H
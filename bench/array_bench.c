@@ -0,0 +1,81 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// Cold-start cost of a large table of mutexes: malloc plus one
+// mutex_init() per element against mutex_array_create(), followed by one
+// lock/unlock of every element (which pays any remaining page faults).
+//
+// Usage: array_bench [mutexes] [threads]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../mutex.h"
+#include "../parking_lot.h"
+
+static double ms_since(const uint64_t start) {
+    return (double) (parking_lot_now_ns() - start) / 1e6;
+}
+
+static double touch_all(mutex_t *array, const size_t n, const int packed) {
+    const uint64_t start = parking_lot_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        mutex_t *m = packed ? &array[i] : mutex_array_at(array, i);
+        mutex_lock(m);
+        mutex_unlock(m);
+    }
+    return ms_since(start);
+}
+
+int main(const int argc, char **argv) {
+    const size_t n = argc > 1 ? strtoull(argv[1], NULL, 10) : (size_t) 4 << 20;
+    const unsigned threads = argc > 2 ? (unsigned) atoi(argv[2]) : 4;
+
+    printf("%zu mutexes (%zu MiB)\n", n, n * sizeof(mutex_t) >> 20);
+    printf("%-36s %10s %10s\n", "", "create ms", "touch ms");
+
+    uint64_t start = parking_lot_now_ns();
+    mutex_t *plain = (mutex_t *) malloc(n * sizeof(mutex_t));
+    if (!plain) {
+        fprintf(stderr, "malloc failed\n");
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        mutex_init(&plain[i]);
+    }
+    double create = ms_since(start);
+    printf("%-36s %10.1f %10.1f\n", "malloc + mutex_init loop", create, touch_all(plain, n, 1));
+    for (size_t i = 0; i < n; i++) {
+        mutex_destroy(&plain[i]);
+    }
+    free(plain);
+
+    start = parking_lot_now_ns();
+    mutex_t *array = mutex_array_create(n, 0);
+    create = ms_since(start);
+    if (!array) {
+        fprintf(stderr, "mutex_array_create failed\n");
+        return 1;
+    }
+    printf("%-36s %10.1f %10.1f\n", "mutex_array_create", create, touch_all(array, n, 0));
+    mutex_array_destroy(array);
+
+    start = parking_lot_now_ns();
+    array = mutex_array_create_ex(n, 0, threads);
+    create = ms_since(start);
+    if (!array) {
+        fprintf(stderr, "mutex_array_create_ex failed\n");
+        return 1;
+    }
+    char label[64];
+    snprintf(label, sizeof(label), "mutex_array_create_ex, %u threads", threads);
+    printf("%-36s %10.1f %10.1f\n", label, create, touch_all(array, n, 0));
+    mutex_array_destroy(array);
+    return 0;
+}
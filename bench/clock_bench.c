@@ -0,0 +1,65 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// Cost of a timestamp: parking_lot_now_ns() (CLOCK_MONOTONIC) against
+// cycleclock_now_ns(), and how far the two drift apart.
+//
+// Usage: clock_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../cycleclock.h"
+#include "../parking_lot.h"
+
+static const char *source_name(const cycleclock_source_t source) {
+    switch (source) {
+        case CYCLECLOCK_TSC: return "tsc";
+        case CYCLECLOCK_CNTVCT: return "cntvct";
+        case CYCLECLOCK_MONOTONIC: return "monotonic";
+        default: return "uncalibrated";
+    }
+}
+
+int main(const int argc, char **argv) {
+    const uint64_t iterations = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+
+    const uint64_t calibrate_start = parking_lot_now_ns();
+    cycleclock_init();
+    printf("source %s, %llu Hz, calibrated in %.2f ms\n", source_name(cycleclock_source()),
+           (unsigned long long) cycleclock_frequency(),
+           (double) (parking_lot_now_ns() - calibrate_start) / 1e6);
+
+    volatile uint64_t sink = 0;
+    uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += parking_lot_now_ns();
+    }
+    const double monotonic = (double) (parking_lot_now_ns() - start) / (double) iterations;
+
+    start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += cycleclock_now_ns();
+    }
+    const double cycle = (double) (parking_lot_now_ns() - start) / (double) iterations;
+    (void) sink;
+
+    printf("%-20s %8.2f ns/call\n", "parking_lot_now_ns", monotonic);
+    printf("%-20s %8.2f ns/call\n", "cycleclock_now_ns", cycle);
+
+    // Drift over a longer interval than the calibration window
+    const uint64_t m0 = parking_lot_now_ns(), c0 = cycleclock_now_ns();
+    while (parking_lot_now_ns() - m0 < 200000000) {
+    }
+    const uint64_t m1 = parking_lot_now_ns(), c1 = cycleclock_now_ns();
+    const double drift = ((double) (c1 - c0) - (double) (m1 - m0)) / (double) (m1 - m0) * 1e6;
+    printf("drift over %.0f ms: %+.1f ppm, offset %+lld ns\n", (double) (m1 - m0) / 1e6, drift,
+           (long long) (c1 - m1));
+    return 0;
+}
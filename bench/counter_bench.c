@@ -0,0 +1,135 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// Increment cost of a statistics counter shared by several threads: an
+// integer guarded by mutex_t, a single atomic integer, and the sharded
+// counter_t.
+//
+// Usage: counter_bench [threads] [iterations]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../counter.h"
+#include "../mutex.h"
+#include "../parking_lot.h"
+
+typedef enum {
+    MODE_MUTEX,
+    MODE_ATOMIC,
+    MODE_SHARDED
+} bench_mode_t;
+
+static bench_mode_t mode = MODE_MUTEX;
+static uint64_t iterations = 10000000;
+
+static mutex_t plain_lock;
+static int64_t plain = 0;
+static int64_t atomic_plain = 0;
+static counter_t sharded;
+
+static void *worker(void *arg) {
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        switch (mode) {
+            case MODE_MUTEX:
+                mutex_lock(&plain_lock);
+                plain++;
+                mutex_unlock(&plain_lock);
+                break;
+            case MODE_ATOMIC:
+                __atomic_fetch_add(&atomic_plain, 1, __ATOMIC_RELAXED);
+                break;
+            case MODE_SHARDED:
+                counter_inc(&sharded);
+                break;
+        }
+    }
+    *(double *) arg = (double) (parking_lot_now_ns() - start) / (double) iterations;
+    return NULL;
+}
+
+/**
+ * @return Mean ns per increment seen by each thread.
+ */
+static double bench_run(const int threads) {
+    pthread_t *t = (pthread_t *) malloc((size_t) threads * sizeof(pthread_t));
+    double *ns = (double *) calloc((size_t) threads, sizeof(double));
+
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&t[i], NULL, worker, &ns[i]);
+    }
+    double total = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(t[i], NULL);
+        total += ns[i];
+    }
+
+    free(ns);
+    free(t);
+    return total / threads;
+}
+
+static double bench_read(void) {
+    volatile int64_t sink = 0;
+    const uint64_t reads = iterations / 100 + 1;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < reads; i++) {
+        sink += counter_read(&sharded);
+    }
+    return (double) (parking_lot_now_ns() - start) / (double) reads;
+}
+
+static double bench_read_approx(void) {
+    volatile int64_t sink = 0;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += counter_read_approx(&sharded, 1000000);
+    }
+    return (double) (parking_lot_now_ns() - start) / (double) iterations;
+}
+
+int main(const int argc, char **argv) {
+    const int max_threads = argc > 1 ? atoi(argv[1]) : 4;
+    if (argc > 2) {
+        iterations = strtoull(argv[2], NULL, 10);
+    }
+    mutex_init(&plain_lock);
+    if (counter_init(&sharded, 0) != 0) {
+        fprintf(stderr, "counter_init failed\n");
+        return 1;
+    }
+
+    printf("%-8s %12s %12s %12s\n", "threads", "mutex", "atomic", "counter_t");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        mode = MODE_MUTEX;
+        const double m = bench_run(threads);
+        mode = MODE_ATOMIC;
+        const double a = bench_run(threads);
+        mode = MODE_SHARDED;
+        const double s = bench_run(threads);
+        printf("%-8d %9.2f ns %9.2f ns %9.2f ns\n", threads, m, a, s);
+    }
+
+    const int64_t expected = __atomic_load_n(&atomic_plain, __ATOMIC_RELAXED);
+    if (plain != expected || counter_read(&sharded) != expected) {
+        fprintf(stderr, "count mismatch: mutex %lld, atomic %lld, counter_t %lld\n",
+                (long long) plain, (long long) expected, (long long) counter_read(&sharded));
+        return 1;
+    }
+
+    printf("\n%-34s %8s\n", "reads", "ns/op");
+    printf("%-34s %8.2f\n", "counter_read", bench_read());
+    printf("%-34s %8.2f\n", "counter_read_approx (1 ms)", bench_read_approx());
+
+    counter_destroy(&sharded);
+    mutex_destroy(&plain_lock);
+    return 0;
+}
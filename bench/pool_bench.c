@@ -0,0 +1,137 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// Allocation cost of small fixed-size nodes: malloc/free against
+// pool_alloc/pool_free, with each thread allocating a burst of nodes and
+// then freeing them, and with nodes freed by a different thread than the
+// one that allocated them (through a shared queue).
+//
+// Usage: pool_bench [threads] [iterations]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../mpmc_queue.h"
+#include "../parking_lot.h"
+#include "../pool.h"
+
+#define BURST 64
+#define NODE_SIZE 48
+
+typedef enum {
+    MODE_MALLOC,
+    MODE_POOL
+} bench_mode_t;
+
+static bench_mode_t mode = MODE_MALLOC;
+static uint64_t iterations = 2000000;
+static pool_t nodes;
+static mpmc_queue_t handoff;
+
+static void *node_alloc(void) {
+    return mode == MODE_POOL ? pool_alloc(&nodes) : malloc(NODE_SIZE);
+}
+
+static void node_free(void *n) {
+    if (mode == MODE_POOL) {
+        pool_free(&nodes, n);
+    } else {
+        free(n);
+    }
+}
+
+static void *burst_worker(void *arg) {
+    void *burst[BURST];
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i += BURST) {
+        for (int j = 0; j < BURST; j++) {
+            burst[j] = node_alloc();
+            *(volatile uint64_t *) burst[j] = i;
+        }
+        for (int j = 0; j < BURST; j++) {
+            node_free(burst[j]);
+        }
+    }
+    *(double *) arg = (double) (parking_lot_now_ns() - start) / (double) iterations;
+    return NULL;
+}
+
+static void *producer(void *arg) {
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        mpmc_queue_enqueue(&handoff, node_alloc());
+    }
+    *(double *) arg = (double) (parking_lot_now_ns() - start) / (double) iterations;
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    (void) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        node_free(mpmc_queue_dequeue(&handoff));
+    }
+    return NULL;
+}
+
+static double bench_burst(const int threads) {
+    pthread_t *t = (pthread_t *) malloc((size_t) threads * sizeof(pthread_t));
+    double *ns = (double *) calloc((size_t) threads, sizeof(double));
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&t[i], NULL, burst_worker, &ns[i]);
+    }
+    double total = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(t[i], NULL);
+        total += ns[i];
+    }
+    free(ns);
+    free(t);
+    return total / threads;
+}
+
+static double bench_handoff(void) {
+    pthread_t p, c;
+    double ns = 0;
+    pthread_create(&c, NULL, consumer, NULL);
+    pthread_create(&p, NULL, producer, &ns);
+    pthread_join(p, NULL);
+    pthread_join(c, NULL);
+    return ns;
+}
+
+int main(const int argc, char **argv) {
+    const int max_threads = argc > 1 ? atoi(argv[1]) : 4;
+    if (argc > 2) {
+        iterations = strtoull(argv[2], NULL, 10);
+    }
+    if (pool_init(&nodes, NODE_SIZE) != 0 || mpmc_queue_init(&handoff, 1024) != 0) {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+
+    printf("%-24s %12s %12s\n", "alloc + free, ns/op", "malloc", "pool");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        mode = MODE_MALLOC;
+        const double m = bench_burst(threads);
+        mode = MODE_POOL;
+        const double p = bench_burst(threads);
+        printf("burst, %-2d threads        %9.2f ns %9.2f ns\n", threads, m, p);
+    }
+
+    mode = MODE_MALLOC;
+    const double m = bench_handoff();
+    mode = MODE_POOL;
+    const double p = bench_handoff();
+    printf("%-24s %9.2f ns %9.2f ns\n", "cross-thread free", m, p);
+
+    mpmc_queue_destroy(&handoff);
+    pool_destroy(&nodes);
+    return 0;
+}
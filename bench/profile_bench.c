@@ -0,0 +1,70 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// Cost of the contention profiler: threads hammer one mutex with a short
+// critical section, with sampling off and at a few rates.
+//
+// Usage: profile_bench [threads] [iterations]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../mutex.h"
+#include "../parking_lot.h"
+
+static mutex_t lock;
+static uint64_t iterations = 2000000;
+static volatile uint64_t shared = 0;
+
+static void *worker(void *arg) {
+    (void) arg;
+    for (uint64_t i = 0; i < iterations; i++) {
+        mutex_lock(&lock);
+        shared++;
+        mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+static double run(const int threads) {
+    pthread_t *t = (pthread_t *) malloc((size_t) threads * sizeof(pthread_t));
+    const uint64_t start = parking_lot_now_ns();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&t[i], NULL, worker, NULL);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(t[i], NULL);
+    }
+    free(t);
+    return (double) (parking_lot_now_ns() - start) / (double) (iterations * (uint64_t) threads);
+}
+
+int main(const int argc, char **argv) {
+    const int threads = argc > 1 ? atoi(argv[1]) : 4;
+    if (argc > 2) {
+        iterations = strtoull(argv[2], NULL, 10);
+    }
+    mutex_init(&lock);
+
+    static const uint32_t rates[] = { 0, 1000, 100, 10, 1 };
+    printf("%d threads, lock + unlock\n", threads);
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        mutex_profile_reset();
+        mutex_profile_set_rate(rates[i]);
+        const double ns = run(threads);
+        if (rates[i] == 0) {
+            printf("%-12s %9.2f ns/op\n", "off", ns);
+        } else {
+            printf("1 in %-7u %9.2f ns/op\n", rates[i], ns);
+        }
+    }
+    mutex_profile_set_rate(0);
+    return 0;
+}
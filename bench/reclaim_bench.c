@@ -0,0 +1,239 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// Read-side cost of the reclamation schemes (epochs, hazard pointers, RCU)
+// next to an uncontended mutex_t, alone and while reader threads share a
+// pointer that a writer keeps replacing and retiring.
+//
+// Usage: reclaim_bench [readers] [iterations]
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "../ebr.h"
+#include "../hazard.h"
+#include "../mutex.h"
+#include "../parking_lot.h"
+#include "../rcu.h"
+
+typedef struct {
+    ebr_node_t ebr;
+    rcu_head_t rcu;
+    uint64_t value;
+} item_t;
+
+static item_t *shared = NULL;
+static mutex_t shared_lock;
+typedef enum {
+    MODE_EBR,
+    MODE_HAZARD,
+    MODE_RCU,
+    MODE_MUTEX
+} bench_mode_t;
+
+static bench_mode_t mode = MODE_EBR;
+static int stop = 0;
+static uint64_t iterations = 10000000;
+
+static void item_free(ebr_node_t *node) {
+    free((char *) node - offsetof(item_t, ebr));
+}
+
+static void item_rcu_free(rcu_head_t *head) {
+    free((char *) head - offsetof(item_t, rcu));
+}
+
+static double bench_empty(void) {
+    volatile uint64_t sink = 0;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        sink += i;
+    }
+    return (double) (parking_lot_now_ns() - start) / (double) iterations;
+}
+
+static double bench_ebr(void) {
+    volatile uint64_t sink = 0;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        ebr_enter();
+        sink += i;
+        ebr_exit();
+    }
+    return (double) (parking_lot_now_ns() - start) / (double) iterations;
+}
+
+static double bench_ebr_nested(void) {
+    volatile uint64_t sink = 0;
+    ebr_enter();
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        ebr_enter();
+        sink += i;
+        ebr_exit();
+    }
+    const uint64_t elapsed = parking_lot_now_ns() - start;
+    ebr_exit();
+    return (double) elapsed / (double) iterations;
+}
+
+static double bench_hazard(void) {
+    volatile uint64_t sink = 0;
+    item_t item = { { NULL, NULL, 0 }, { NULL, NULL }, 1 };
+    item_t *src = &item;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        const item_t *p = (const item_t *) hazard_protect(0, (void *const *) &src);
+        sink += p->value;
+        hazard_clear(0);
+    }
+    return (double) (parking_lot_now_ns() - start) / (double) iterations;
+}
+
+static double bench_rcu(void) {
+    volatile uint64_t sink = 0;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        rcu_read_lock();
+        sink += i;
+        rcu_read_unlock();
+    }
+    return (double) (parking_lot_now_ns() - start) / (double) iterations;
+}
+
+static double bench_mutex(void) {
+    volatile uint64_t sink = 0;
+    mutex_t m;
+    mutex_init(&m);
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        mutex_lock(&m);
+        sink += i;
+        mutex_unlock(&m);
+    }
+    const uint64_t elapsed = parking_lot_now_ns() - start;
+    mutex_destroy(&m);
+    return (double) elapsed / (double) iterations;
+}
+
+static void *reader(void *arg) {
+    uint64_t sum = 0;
+    const uint64_t start = parking_lot_now_ns();
+    for (uint64_t i = 0; i < iterations; i++) {
+        switch (mode) {
+            case MODE_EBR:
+                ebr_enter();
+                sum += __atomic_load_n(&shared, __ATOMIC_ACQUIRE)->value;
+                ebr_exit();
+                break;
+            case MODE_HAZARD:
+                sum += ((item_t *) hazard_protect(0, (void *const *) &shared))->value;
+                hazard_clear(0);
+                break;
+            case MODE_RCU:
+                rcu_read_lock();
+                sum += rcu_dereference(shared)->value;
+                rcu_read_unlock();
+                break;
+            case MODE_MUTEX:
+                mutex_lock(&shared_lock);
+                sum += shared->value;
+                mutex_unlock(&shared_lock);
+                break;
+        }
+    }
+    *(double *) arg = (double) (parking_lot_now_ns() - start) / (double) iterations;
+    return (void *) (uintptr_t) sum;
+}
+
+static void *writer(void *arg) {
+    (void) arg;
+    uint64_t v = 0;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        item_t *fresh = (item_t *) malloc(sizeof(item_t));
+        fresh->value = ++v;
+        if (mode == MODE_MUTEX) {
+            mutex_lock(&shared_lock);
+            item_t *old = shared;
+            shared = fresh;
+            mutex_unlock(&shared_lock);
+            free(old);
+        } else {
+            item_t *old = __atomic_exchange_n(&shared, fresh, __ATOMIC_ACQ_REL);
+            if (mode == MODE_EBR) {
+                ebr_retire(&old->ebr, item_free);
+            } else if (mode == MODE_RCU) {
+                call_rcu(&old->rcu, item_rcu_free);
+            } else {
+                hazard_retire(old, free);
+            }
+        }
+        mutex_thread_yield();
+    }
+    ebr_synchronize();
+    hazard_scan();
+    rcu_barrier();
+    return NULL;
+}
+
+static double bench_shared(const int readers) {
+    pthread_t w;
+    pthread_t *r = (pthread_t *) malloc((size_t) readers * sizeof(pthread_t));
+    double *ns = (double *) calloc((size_t) readers, sizeof(double));
+
+    shared = (item_t *) calloc(1, sizeof(item_t));
+    stop = 0;
+    pthread_create(&w, NULL, writer, NULL);
+    for (int i = 0; i < readers; i++) {
+        pthread_create(&r[i], NULL, reader, &ns[i]);
+    }
+    double total = 0;
+    for (int i = 0; i < readers; i++) {
+        pthread_join(r[i], NULL);
+        total += ns[i];
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+    pthread_join(w, NULL);
+
+    free(shared);
+    free(ns);
+    free(r);
+    return total / readers;
+}
+
+int main(const int argc, char **argv) {
+    const int readers = argc > 1 ? atoi(argv[1]) : 4;
+    if (argc > 2) {
+        iterations = strtoull(argv[2], NULL, 10);
+    }
+    mutex_init(&shared_lock);
+
+    printf("%-34s %8s\n", "single thread", "ns/op");
+    printf("%-34s %8.2f\n", "empty loop", bench_empty());
+    printf("%-34s %8.2f\n", "ebr_enter/ebr_exit", bench_ebr());
+    printf("%-34s %8.2f\n", "nested ebr_enter/ebr_exit", bench_ebr_nested());
+    printf("%-34s %8.2f\n", "hazard_protect/hazard_clear", bench_hazard());
+    printf("%-34s %8.2f\n", "rcu_read_lock/rcu_read_unlock", bench_rcu());
+    printf("%-34s %8.2f\n", "mutex_lock/mutex_unlock", bench_mutex());
+
+    printf("\n%d readers, 1 writer replacing the item\n", readers);
+    mode = MODE_EBR;
+    printf("%-34s %8.2f\n", "ebr read", bench_shared(readers));
+    mode = MODE_HAZARD;
+    printf("%-34s %8.2f\n", "hazard read", bench_shared(readers));
+    mode = MODE_RCU;
+    printf("%-34s %8.2f\n", "rcu read", bench_shared(readers));
+    mode = MODE_MUTEX;
+    printf("%-34s %8.2f\n", "mutex read", bench_shared(readers));
+
+    mutex_destroy(&shared_lock);
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include "counter.h"
+
+#ifndef _WIN32
+#   include <unistd.h>
+#endif
+
+static uint32_t next_thread_shard = 0;
+static FLUENT_LIBC_THREAD_LOCAL uint32_t thread_shard = 0; // index + 1, 0 until assigned
+
+/**
+ * @brief Number of CPUs the system is configured with, at least 1.
+ */
+static uint32_t counter_cpu_count(void) {
+#if defined(_WIN32) && !defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const long n = (long) info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_CONF)
+    const long n = sysconf(_SC_NPROCESSORS_CONF);
+#else
+    const long n = 1;
+#endif
+    return n > 0 ? (uint32_t) n : 1;
+}
+
+int counter_init(counter_t *c, uint32_t shards) {
+    if (shards == 0) {
+        shards = counter_cpu_count();
+    }
+    if (shards > COUNTER_MAX_SHARDS) {
+        shards = COUNTER_MAX_SHARDS;
+    }
+
+    uint32_t n = 1;
+    while (n < shards) {
+        n <<= 1;
+    }
+
+    // Cells are 64 bytes apart, so no two values share a line even
+    // without 64-byte alignment
+    c->cells = (counter_cell_t *) calloc(n, sizeof(counter_cell_t));
+    if (!c->cells) {
+        return ENOMEM;
+    }
+    c->mask = n - 1;
+    // Calibrate here rather than in the first counter_read_approx()
+    cycleclock_init();
+    c->cache.s.value = 0;
+    c->cache.s.at_ns = 0;
+    return 0;
+}
+
+void counter_destroy(counter_t *c) {
+    free(c->cells);
+    c->cells = NULL;
+    c->mask = 0;
+}
+
+uint32_t counter_thread_shard(void) {
+    uint32_t shard = thread_shard;
+    if (!shard) {
+        shard = __atomic_add_fetch(&next_thread_shard, 1, __ATOMIC_RELAXED);
+        thread_shard = shard;
+    }
+    return shard - 1;
+}
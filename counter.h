@@ -0,0 +1,230 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_COUNTER_LIBRARY_H
+#define FLUENT_LIBC_COUNTER_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// counter_t API
+// ----------------------------------------
+// Sharded statistics counter, a replacement for a plain integer guarded
+// by a mutex_t. The value is spread over cells that each sit on their own
+// cache line, one per CPU. An increment is a relaxed atomic add to the
+// cell of the CPU the caller runs on, so it costs no lock and the cell
+// line stays in that CPU's cache. Where the CPU cannot be queried, each
+// thread gets a fixed cell instead.
+//
+// Reading sums every cell. The sum is exact once writers are quiescent;
+// under concurrent updates it is a value the counter held at some point
+// during the read. counter_read_approx() returns a cached sum that is at
+// most max_age_ns old, for readers that poll often (e.g. metrics
+// endpoints).
+// ----------------------------------------
+// Features:
+// - counter_init:          Allocate a counter with a number of cells.
+// - counter_add:           Add a signed delta.
+// - counter_inc:           Add one.
+// - counter_dec:           Subtract one.
+// - counter_read:          Sum of all cells.
+// - counter_read_approx:   Cached sum, refreshed when older than a bound.
+// - counter_reset:         Zero the counter and return its previous value.
+// - counter_destroy:       Release counter memory.
+//
+// Function Signatures:
+// ----------------------------------------
+// int counter_init(counter_t *c, uint32_t shards);
+//     Example:
+//         counter_t hits;
+//         counter_init(&hits, 0); // one cell per CPU
+//
+// void counter_add(counter_t *c, int64_t delta);
+//     Example:
+//         counter_add(&bytes, n);
+//
+// void counter_inc(counter_t *c);
+// void counter_dec(counter_t *c);
+//     Example:
+//         counter_inc(&hits);
+//
+// int64_t counter_read(const counter_t *c);
+//     Example:
+//         printf("%lld hits\n", (long long) counter_read(&hits));
+//
+// int64_t counter_read_approx(counter_t *c, uint64_t max_age_ns);
+//     Example:
+//         int64_t hits_now = counter_read_approx(&hits, 10000000); // 10 ms
+//
+// int64_t counter_reset(counter_t *c);
+//     Example:
+//         int64_t per_interval = counter_reset(&hits);
+//
+// void counter_destroy(counter_t *c);
+//     Example:
+//         counter_destroy(&hits);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h, cycleclock.h
+// ----------------------------------------
+
+#include <stdint.h>
+#include "mutex.h"
+#include "cycleclock.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Upper bound on the cells of one counter.
+ */
+#ifndef COUNTER_MAX_SHARDS
+#   define COUNTER_MAX_SHARDS 256u
+#endif
+
+/**
+ * @brief One shard of the value, on its own cache line.
+ */
+typedef union {
+    int64_t value;
+    char pad[64];
+} counter_cell_t;
+
+/**
+ * @brief Last aggregated value, on its own cache line so that refreshing
+ * it does not disturb writers.
+ */
+typedef union {
+    struct {
+        int64_t value;      /**< Sum at the last refresh */
+        uint64_t at_ns;     /**< cycleclock_now_ns() of the last refresh, 0 if none */
+    } s;
+    char pad[64];
+} counter_cache_t;
+
+/**
+ * @brief Sharded counter.
+ */
+typedef struct {
+    counter_cell_t *cells;  /**< mask + 1 cells */
+    uint32_t mask;          /**< Number of cells - 1 */
+    counter_cache_t cache;  /**< Approximate total for counter_read_approx() */
+} counter_t;
+
+/**
+ * @brief Initializes the counter to zero.
+ *
+ * @param c Pointer to the counter_t structure to initialize.
+ * @param shards Number of cells, rounded up to a power of two and capped
+ * at COUNTER_MAX_SHARDS; 0 picks one per configured CPU.
+ * @return 0 on success, ENOMEM on allocation failure.
+ */
+int counter_init(counter_t *c, uint32_t shards);
+
+/**
+ * @brief Releases the cells. The counter must not be in use.
+ */
+void counter_destroy(counter_t *c);
+
+/**
+ * @brief Cell index for threads whose CPU cannot be queried, assigned
+ * round robin on first use. Implemented in counter.c.
+ */
+uint32_t counter_thread_shard(void);
+
+/**
+ * @brief Adds a signed delta.
+ *
+ * @param c The counter.
+ * @param delta Amount to add; negative to subtract.
+ */
+static inline void counter_add(counter_t *c, const int64_t delta) {
+    const int cpu = mutex_current_cpu();
+    const uint32_t shard = cpu >= 0 ? (uint32_t) cpu : counter_thread_shard();
+    // Atomic because threads sharing a CPU, or migrating, share a cell
+    __atomic_fetch_add(&c->cells[shard & c->mask].value, delta, __ATOMIC_RELAXED);
+}
+
+static inline void counter_inc(counter_t *c) {
+    counter_add(c, 1);
+}
+
+static inline void counter_dec(counter_t *c) {
+    counter_add(c, -1);
+}
+
+/**
+ * @brief Sums every cell.
+ *
+ * @param c The counter.
+ * @return The current value.
+ */
+static inline int64_t counter_read(const counter_t *c) {
+    int64_t sum = 0;
+    for (uint32_t i = 0; i <= c->mask; i++) {
+        sum += __atomic_load_n(&c->cells[i].value, __ATOMIC_RELAXED);
+    }
+    return sum;
+}
+
+/**
+ * @brief Returns a sum at most `max_age_ns` old, refreshing it if needed.
+ *
+ * Concurrent refreshes are harmless; the last one wins. A single-cell
+ * counter is read directly: its cell is one line, like the cache.
+ *
+ * @param c The counter.
+ * @param max_age_ns Oldest cached value the caller accepts.
+ * @return The cached or freshly computed value.
+ */
+static inline int64_t counter_read_approx(counter_t *c, const uint64_t max_age_ns) {
+    if (c->mask == 0) {
+        return __atomic_load_n(&c->cells[0].value, __ATOMIC_RELAXED);
+    }
+
+    const uint64_t now = cycleclock_now_ns();
+    const uint64_t at = __atomic_load_n(&c->cache.s.at_ns, __ATOMIC_ACQUIRE);
+    if (at != 0 && now - at <= max_age_ns) {
+        return __atomic_load_n(&c->cache.s.value, __ATOMIC_RELAXED);
+    }
+
+    const int64_t sum = counter_read(c);
+    __atomic_store_n(&c->cache.s.value, sum, __ATOMIC_RELAXED);
+    __atomic_store_n(&c->cache.s.at_ns, now, __ATOMIC_RELEASE);
+    return sum;
+}
+
+/**
+ * @brief Zeroes every cell and returns the total they held.
+ *
+ * No increment is lost: each cell is drained with an atomic exchange,
+ * so a concurrent add lands either in the returned total or in the
+ * counter afterwards.
+ *
+ * @param c The counter.
+ * @return The value before the reset.
+ */
+static inline int64_t counter_reset(counter_t *c) {
+    int64_t sum = 0;
+    for (uint32_t i = 0; i <= c->mask; i++) {
+        sum += __atomic_exchange_n(&c->cells[i].value, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&c->cache.s.at_ns, 0, __ATOMIC_RELAXED);
+    return sum;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_COUNTER_LIBRARY_H
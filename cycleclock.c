@@ -0,0 +1,164 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "cycleclock.h"
+#include "mutex.h"
+
+#if defined(CYCLECLOCK_X86)
+#   include <cpuid.h>
+#endif
+
+cycleclock_t cycleclock_state;
+
+static uint32_t init_state = 0; // 0 = not started, 1 = calibrating, 2 = done
+
+#if defined(CYCLECLOCK_X86)
+static void cycleclock_cpuid(const uint32_t leaf, uint32_t regs[4]) {
+    __cpuid(leaf, regs[0], regs[1], regs[2], regs[3]);
+}
+
+/**
+ * @brief Whether the kernel would disagree with using the TSC.
+ *
+ * Linux switches away from the TSC when it finds it unsynchronized
+ * across CPUs or unstable; follow its judgement where it is visible.
+ */
+static int tsc_distrusted_by_kernel(void) {
+#   if defined(__linux__)
+        FILE *f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+        if (!f) {
+            return 0;
+        }
+        char name[32] = { 0 };
+        const int read = fgets(name, sizeof(name), f) != NULL;
+        fclose(f);
+        return read && strncmp(name, "tsc", 3) != 0;
+#   else
+        return 0;
+#   endif
+}
+
+static int tsc_usable(void) {
+    uint32_t regs[4];
+    cycleclock_cpuid(0x80000000u, regs);
+    if (regs[0] < 0x80000007u) {
+        return 0;
+    }
+    cycleclock_cpuid(0x80000001u, regs);
+    const int rdtscp = (regs[3] >> 27) & 1;
+    cycleclock_cpuid(0x80000007u, regs);
+    const int invariant = (regs[3] >> 8) & 1;
+    return rdtscp && invariant && !tsc_distrusted_by_kernel();
+}
+
+/**
+ * @brief TSC rate from CPUID leaf 0x15 (crystal clock times the TSC
+ * ratio), or 0 when the CPU does not report it.
+ */
+static uint64_t tsc_reported_hz(void) {
+    uint32_t regs[4];
+    cycleclock_cpuid(0, regs);
+    if (regs[0] < 0x15) {
+        return 0;
+    }
+    cycleclock_cpuid(0x15, regs);
+    if (regs[0] == 0 || regs[1] == 0 || regs[2] == 0) {
+        return 0;
+    }
+    return (uint64_t) regs[2] * regs[1] / regs[0];
+}
+#endif
+
+/**
+ * @brief Reads the counter and the monotonic clock as close together as
+ * possible: the best of a few attempts, with the counter taken on both
+ * sides of the clock read.
+ */
+static void cycleclock_pair(uint64_t *ticks, uint64_t *ns) {
+    *ticks = cycleclock_ticks();
+    *ns = parking_lot_now_ns();
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 5; i++) {
+        const uint64_t before = cycleclock_ticks();
+        const uint64_t now = parking_lot_now_ns();
+        const uint64_t after = cycleclock_ticks();
+        if (after - before < best) {
+            best = after - before;
+            *ticks = before + (after - before) / 2;
+            *ns = now;
+        }
+    }
+}
+
+/**
+ * @brief Measures the counter rate against CLOCK_MONOTONIC.
+ */
+static uint64_t cycleclock_measure_hz(void) {
+    uint64_t t0, ns0, t1, ns1;
+    cycleclock_pair(&t0, &ns0);
+    do {
+        mutex_cpu_relax();
+        ns1 = parking_lot_now_ns();
+    } while (ns1 - ns0 < CYCLECLOCK_CALIBRATION_NS);
+    cycleclock_pair(&t1, &ns1);
+    return ns1 > ns0 ? (uint64_t) ((double) (t1 - t0) * 1e9 / (double) (ns1 - ns0)) : 0;
+}
+
+static void cycleclock_calibrate(void) {
+    uint32_t source = CYCLECLOCK_MONOTONIC;
+    uint64_t hz = 0;
+#if defined(CYCLECLOCK_X86)
+    if (tsc_usable()) {
+        hz = tsc_reported_hz();
+        if (hz == 0) {
+            hz = cycleclock_measure_hz();
+        }
+        source = CYCLECLOCK_TSC;
+    }
+#elif defined(CYCLECLOCK_ARM64)
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(hz));
+    source = CYCLECLOCK_CNTVCT;
+#endif
+
+    if (source == CYCLECLOCK_MONOTONIC || hz == 0) {
+        cycleclock_state.hz = 1000000000ULL;
+        __atomic_store_n(&cycleclock_state.source, CYCLECLOCK_MONOTONIC, __ATOMIC_RELEASE);
+        return;
+    }
+
+    cycleclock_state.hz = hz;
+    cycleclock_state.mult = (uint64_t) (1e9 * 4294967296.0 / (double) hz);
+    cycleclock_pair(&cycleclock_state.base_ticks, &cycleclock_state.base_ns);
+    __atomic_store_n(&cycleclock_state.source, source, __ATOMIC_RELEASE);
+}
+
+void cycleclock_init(void) {
+    uint32_t expected = 0;
+    if (__atomic_compare_exchange_n(&init_state, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        cycleclock_calibrate();
+        __atomic_store_n(&init_state, 2, __ATOMIC_RELEASE);
+        return;
+    }
+    while (__atomic_load_n(&init_state, __ATOMIC_ACQUIRE) != 2) {
+        mutex_thread_yield();
+    }
+}
+
+cycleclock_source_t cycleclock_source(void) {
+    cycleclock_init();
+    return (cycleclock_source_t) __atomic_load_n(&cycleclock_state.source, __ATOMIC_ACQUIRE);
+}
+
+uint64_t cycleclock_frequency(void) {
+    cycleclock_init();
+    return cycleclock_state.hz;
+}
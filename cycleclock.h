@@ -0,0 +1,189 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_CYCLECLOCK_LIBRARY_H
+#define FLUENT_LIBC_CYCLECLOCK_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// cycleclock API
+// ----------------------------------------
+// Cheap monotonic nanosecond clock for instrumentation. clock_gettime()
+// costs 20 ns or more, which distorts the short critical sections that
+// lock profiling measures. This clock reads a CPU counter instead:
+// - x86: RDTSCP, but only when the TSC is invariant (constant rate,
+//   keeps running in deep C-states) and, on Linux, the kernel still uses
+//   it as its clocksource;
+// - AArch64: the generic timer's virtual count (CNTVCT_EL0), which runs
+//   at the fixed rate in CNTFRQ_EL0.
+// The counter is converted to nanoseconds with a fixed-point multiplier.
+// On x86 the TSC rate comes from CPUID leaf 0x15 when the CPU reports
+// it, else it is measured against CLOCK_MONOTONIC over
+// CYCLECLOCK_CALIBRATION_NS. Anywhere else, and when the counter cannot
+// be trusted, the clock is parking_lot_now_ns().
+//
+// Calibration happens once, in cycleclock_init(). Call it at startup:
+// it reads sysfs, runs CPUID and may busy-wait for the calibration
+// window. The mutex instrumentation calls it when it is switched on. A
+// read before any cycleclock_init() still works but calibrates on the
+// spot. Readings share CLOCK_MONOTONIC's epoch at calibration, are
+// comparable across threads, and are meant for intervals:
+// over hours they can drift from CLOCK_MONOTONIC by the calibration
+// error (parts per million).
+// ----------------------------------------
+// Features:
+// - cycleclock_init:       Calibrate now rather than on first use.
+// - cycleclock_now_ns:     Current time in nanoseconds.
+// - cycleclock_source:     Which counter backs the clock.
+// - cycleclock_frequency:  Counter ticks per second.
+//
+// Function Signatures:
+// ----------------------------------------
+// void cycleclock_init(void);
+//     Example:
+//         cycleclock_init(); // at startup, off the hot paths
+//
+// uint64_t cycleclock_now_ns(void);
+//     Example:
+//         const uint64_t start = cycleclock_now_ns();
+//         ...
+//         const uint64_t took_ns = cycleclock_now_ns() - start;
+//
+// cycleclock_source_t cycleclock_source(void);
+// uint64_t cycleclock_frequency(void);
+//     Example:
+//         if (cycleclock_source() == CYCLECLOCK_TSC) {
+//             printf("TSC at %llu Hz\n", (unsigned long long) cycleclock_frequency());
+//         }
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: parking_lot.h
+// ----------------------------------------
+
+#include <stdint.h>
+#include "parking_lot.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#   define CYCLECLOCK_X86 1
+#   include <x86intrin.h>
+#elif defined(__aarch64__)
+#   define CYCLECLOCK_ARM64 1
+#endif
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief How long the TSC is measured against CLOCK_MONOTONIC when the
+ * CPU does not report its rate.
+ */
+#ifndef CYCLECLOCK_CALIBRATION_NS
+#   define CYCLECLOCK_CALIBRATION_NS 2000000
+#endif
+
+/**
+ * @brief Counter behind cycleclock_now_ns().
+ */
+typedef enum {
+    CYCLECLOCK_UNCALIBRATED = 0, /**< Not initialized yet */
+    CYCLECLOCK_MONOTONIC,        /**< parking_lot_now_ns() */
+    CYCLECLOCK_TSC,              /**< x86 time-stamp counter */
+    CYCLECLOCK_CNTVCT            /**< AArch64 virtual counter */
+} cycleclock_source_t;
+
+/**
+ * @brief Calibration shared by every reader.
+ */
+typedef struct {
+    uint32_t source;      /**< cycleclock_source_t, published last */
+    uint64_t hz;          /**< Counter ticks per second */
+    uint64_t mult;        /**< Nanoseconds per tick, as a 32.32 fixed-point number */
+    uint64_t base_ticks;  /**< Counter value at calibration */
+    uint64_t base_ns;     /**< parking_lot_now_ns() at calibration */
+} cycleclock_t;
+
+/**
+ * @brief The calibration; all zero until cycleclock_init() has run.
+ */
+extern cycleclock_t cycleclock_state;
+
+/**
+ * @brief Picks and calibrates the counter. Idempotent and thread-safe;
+ * concurrent callers wait for the first one.
+ */
+void cycleclock_init(void);
+
+/**
+ * @brief Returns the counter behind the clock, calibrating first if needed.
+ */
+cycleclock_source_t cycleclock_source(void);
+
+/**
+ * @brief Returns the counter's ticks per second (1e9 for
+ * CYCLECLOCK_MONOTONIC), calibrating first if needed.
+ */
+uint64_t cycleclock_frequency(void);
+
+/**
+ * @brief Reads the raw counter. Only meaningful when cycleclock_source()
+ * is CYCLECLOCK_TSC or CYCLECLOCK_CNTVCT.
+ */
+static inline uint64_t cycleclock_ticks(void) {
+#   if defined(CYCLECLOCK_X86)
+        // RDTSCP waits for earlier instructions, so the read is not
+        // hoisted above the code being timed
+        unsigned int aux;
+        return __rdtscp(&aux);
+#   elif defined(CYCLECLOCK_ARM64)
+        uint64_t ticks;
+        __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks) :: "memory");
+        return ticks;
+#   else
+        return parking_lot_now_ns();
+#   endif
+}
+
+/**
+ * @brief Returns the current time in nanoseconds.
+ *
+ * @return Nanoseconds since an unspecified starting point, close to
+ * parking_lot_now_ns() but cheaper to read.
+ */
+static inline uint64_t cycleclock_now_ns(void) {
+    const uint32_t source = __atomic_load_n(&cycleclock_state.source, __ATOMIC_ACQUIRE);
+    if (source >= CYCLECLOCK_TSC) {
+        const uint64_t ticks = cycleclock_ticks();
+        // Another CPU's counter may lag the calibrating one's by a few ticks
+        const uint64_t delta = ticks > cycleclock_state.base_ticks ? ticks - cycleclock_state.base_ticks : 0;
+#       if defined(__SIZEOF_INT128__)
+            __extension__ typedef unsigned __int128 cycleclock_u128_t;
+            return cycleclock_state.base_ns + (uint64_t) (((cycleclock_u128_t) delta * cycleclock_state.mult) >> 32);
+#       else
+            return cycleclock_state.base_ns
+                   + (uint64_t) ((double) delta * (double) cycleclock_state.mult / 4294967296.0);
+#       endif
+    }
+    if (source == CYCLECLOCK_UNCALIBRATED) {
+        // Cold: nobody called cycleclock_init() up front
+        cycleclock_init();
+        return cycleclock_now_ns();
+    }
+    return parking_lot_now_ns();
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_CYCLECLOCK_LIBRARY_H
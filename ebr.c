@@ -0,0 +1,140 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include "ebr.h"
+#include "thread_registry.h"
+
+uint64_t ebr_global_epoch = 0;
+
+static thread_registry_t records = THREAD_REGISTRY_INIT(ebr_record_t, r.next, r.next_free, "ebr");
+static FLUENT_LIBC_THREAD_LOCAL ebr_record_t *record = NULL;
+
+// ============= EPOCHS =============
+/**
+ * @brief Advances the global epoch if every active thread has seen it.
+ *
+ * @return The global epoch after the attempt.
+ */
+static uint64_t ebr_try_advance(void) {
+    const uint64_t epoch = __atomic_load_n(&ebr_global_epoch, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (ebr_record_t *r = (ebr_record_t *) __atomic_load_n(&records.head, __ATOMIC_ACQUIRE); r; r = r->r.next) {
+        const uint64_t state = __atomic_load_n(&r->r.state, __ATOMIC_RELAXED);
+        if ((state & 1) && (state >> 1) != epoch) {
+            return epoch;
+        }
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    uint64_t expected = epoch;
+    if (__atomic_compare_exchange_n(&ebr_global_epoch, &expected, epoch + 1, 0,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return epoch + 1;
+    }
+    return expected;
+}
+
+/**
+ * @brief Frees the deferred objects of `self` retired two epochs before `epoch`.
+ */
+static void ebr_reclaim(ebr_record_t *self, const uint64_t epoch) {
+    ebr_node_t *node;
+    while ((node = self->r.head) && node->epoch + 2 <= epoch) {
+        // Unlink first: a reclaim callback may retire more objects
+        self->r.head = node->next;
+        if (!self->r.head) {
+            self->r.tail = NULL;
+        }
+        self->r.pending--;
+        node->reclaim(node);
+    }
+}
+
+// ============= THREAD RECORDS =============
+#ifndef _WIN32
+static pthread_key_t record_key;
+static pthread_once_t record_once = PTHREAD_ONCE_INIT;
+
+static void ebr_record_release(void *arg) {
+    ebr_record_t *self = (ebr_record_t *) arg;
+    // Objects still deferred move on with the record to its next thread
+    ebr_reclaim(self, ebr_try_advance());
+    self->r.nesting = 0;
+    __atomic_store_n(&self->r.state, 0, __ATOMIC_RELEASE);
+    thread_registry_give_back(&records, self);
+}
+
+static void ebr_record_key_create(void) {
+    pthread_key_create(&record_key, ebr_record_release);
+}
+#endif
+
+ebr_record_t *ebr_thread_record(void) {
+    ebr_record_t *self = record;
+    if (self) {
+        return self;
+    }
+
+    self = (ebr_record_t *) thread_registry_take(&records);
+
+#ifndef _WIN32
+    // Recycle the record at thread exit (Windows threads keep theirs)
+    pthread_once(&record_once, ebr_record_key_create);
+    pthread_setspecific(record_key, self);
+#endif
+    record = self;
+    return self;
+}
+
+// ============= RETIRE / RECLAIM =============
+void ebr_retire(ebr_node_t *node, void (*reclaim)(ebr_node_t *)) {
+    ebr_record_t *self = ebr_self();
+
+    node->next = NULL;
+    node->reclaim = reclaim;
+    // Pairs with ebr_enter's fence: the unlink is visible before the tag
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    node->epoch = __atomic_load_n(&ebr_global_epoch, __ATOMIC_RELAXED);
+
+    if (self->r.tail) {
+        self->r.tail->next = node;
+    } else {
+        self->r.head = node;
+    }
+    self->r.tail = node;
+
+    // Amortize the registry scan over a batch of retires
+    if (++self->r.pending % EBR_BATCH == 0) {
+        ebr_reclaim(self, ebr_try_advance());
+    }
+}
+
+void ebr_collect(void) {
+    ebr_record_t *self = ebr_self();
+    ebr_reclaim(self, ebr_try_advance());
+}
+
+void ebr_synchronize(void) {
+    ebr_record_t *self = ebr_self();
+    if (!self->r.tail) {
+        return;
+    }
+
+    const uint64_t target = self->r.tail->epoch + 2;
+    for (;;) {
+        const uint64_t epoch = ebr_try_advance();
+        if (epoch >= target) {
+            ebr_reclaim(self, epoch);
+            return;
+        }
+        mutex_thread_yield();
+    }
+}
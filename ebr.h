@@ -0,0 +1,187 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_EBR_LIBRARY_H
+#define FLUENT_LIBC_EBR_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// ebr API
+// ----------------------------------------
+// Epoch-based memory reclamation. Readers traverse lock-free data
+// structures inside ebr_enter()/ebr_exit(). Writers unlink an object and
+// hand it to ebr_retire(), and the object is freed only once no reader
+// can still hold a reference to it.
+//
+// A global epoch counter advances when every thread inside a critical
+// region has observed the current value. An object retired in epoch e
+// is safe to free once the global epoch reaches e + 2. Retired objects
+// wait on a per-thread deferred list and are freed in batches of
+// EBR_BATCH, so a retire is usually just a list append.
+//
+// Entering a region costs a thread-local load, two plain stores and one
+// full fence; leaving costs one store. Regions nest. A thread that stays
+// in a region forever stops reclamation for everybody, so regions should
+// be short and must not block.
+//
+// Retired objects embed an ebr_node_t (intrusive, no allocation on
+// retire). Per-thread records are recycled when a thread exits, and the
+// next thread inherits any objects still waiting on the record.
+// ----------------------------------------
+// Features:
+// - ebr_enter:        Enter a read-side critical region.
+// - ebr_exit:         Leave a read-side critical region.
+// - ebr_retire:       Defer reclamation of an unlinked object.
+// - ebr_collect:      Try to advance the epoch and free safe objects now.
+// - ebr_synchronize:  Wait until everything this thread retired is freed.
+//
+// Function Signatures:
+// ----------------------------------------
+// void ebr_enter(void);
+// void ebr_exit(void);
+//     Example:
+//         ebr_enter();
+//         node_t *n = __atomic_load_n(&list->head, __ATOMIC_ACQUIRE);
+//         ... read n ...
+//         ebr_exit();
+//
+// void ebr_retire(ebr_node_t *node, void (*reclaim)(ebr_node_t *));
+//     Example:
+//         static void node_free(ebr_node_t *e) { free((char *) e - offsetof(node_t, ebr)); }
+//         ebr_retire(&old->ebr, node_free);
+//
+// void ebr_collect(void);
+//     Example:
+//         ebr_collect();
+//
+// void ebr_synchronize(void);
+//     Example:
+//         ebr_synchronize(); // before unloading the module that owns the nodes
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h, thread_registry.h
+// ----------------------------------------
+
+#include <stdint.h>
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Retired objects a thread accumulates before it tries to reclaim.
+ */
+#ifndef EBR_BATCH
+#   define EBR_BATCH 64u
+#endif
+
+/**
+ * @brief Link embedded in every object handed to ebr_retire().
+ */
+typedef struct ebr_node {
+    struct ebr_node *next;                 /**< Next deferred object */
+    void (*reclaim)(struct ebr_node *);    /**< Frees the enclosing object */
+    uint64_t epoch;                        /**< Global epoch at retire time */
+} ebr_node_t;
+
+/**
+ * @brief Per-thread epoch record, on its own cache line.
+ */
+typedef union ebr_record {
+    struct {
+        uint64_t state;                /**< (epoch << 1) | 1 inside a region, 0 outside */
+        uint32_t nesting;              /**< Depth of nested regions */
+        uint32_t pending;              /**< Objects on the deferred list */
+        ebr_node_t *head;              /**< Oldest deferred object */
+        ebr_node_t *tail;              /**< Newest deferred object */
+        union ebr_record *next;        /**< Registry link; records are never freed */
+        union ebr_record *next_free;   /**< Link in the recycled-record list */
+    } r;
+    char pad[64];
+} ebr_record_t;
+
+/**
+ * @brief Global epoch. Only ebr.c advances it.
+ */
+extern uint64_t ebr_global_epoch;
+
+/**
+ * @brief Returns the calling thread's record, registering it on first use.
+ */
+ebr_record_t *ebr_thread_record(void);
+
+/**
+ * @brief Defers reclamation of an object that is no longer reachable.
+ *
+ * The object must already be unlinked from every shared structure.
+ * `reclaim` runs once no thread can still hold a reference to it; it
+ * may run on another thread that inherits this thread's record.
+ *
+ * @param node Link embedded in the object.
+ * @param reclaim Frees the enclosing object.
+ */
+void ebr_retire(ebr_node_t *node, void (*reclaim)(ebr_node_t *));
+
+/**
+ * @brief Tries to advance the epoch and frees this thread's safe objects.
+ *
+ * Never blocks.
+ */
+void ebr_collect(void);
+
+/**
+ * @brief Waits until every object this thread retired has been freed.
+ *
+ * Must not be called inside a critical region.
+ */
+void ebr_synchronize(void);
+
+static inline ebr_record_t *ebr_self(void) {
+    static FLUENT_LIBC_THREAD_LOCAL ebr_record_t *self = NULL;
+    if (!self) {
+        self = ebr_thread_record();
+    }
+    return self;
+}
+
+/**
+ * @brief Enters a read-side critical region.
+ *
+ * Objects reachable when the region starts stay allocated until it ends.
+ */
+static inline void ebr_enter(void) {
+    ebr_record_t *self = ebr_self();
+    if (self->r.nesting++ == 0) {
+        const uint64_t epoch = __atomic_load_n(&ebr_global_epoch, __ATOMIC_RELAXED);
+        __atomic_store_n(&self->r.state, (epoch << 1) | 1, __ATOMIC_RELAXED);
+        // Publish the epoch before any shared pointer is read
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * @brief Leaves a read-side critical region.
+ */
+static inline void ebr_exit(void) {
+    ebr_record_t *self = ebr_self();
+    if (--self->r.nesting == 0) {
+        __atomic_store_n(&self->r.state, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_EBR_LIBRARY_H
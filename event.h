@@ -0,0 +1,245 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_EVENT_LIBRARY_H
+#define FLUENT_LIBC_EVENT_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// event_t API
+// ----------------------------------------
+// Event / notification primitive in a single 32-bit word: the signaled
+// bit, the reset mode and the number of sleeping waiters. Signalling is
+// one atomic operation, plus at most one futex-style wake when the word
+// says somebody sleeps.
+//
+// - Manual-reset events stay signaled until event_reset() and release
+//   every waiter (shutdown flags, "ready" gates).
+// - Auto-reset events release a single waiter per event_set(), which
+//   consumes the signal (thread-pool wake-ups).
+// ----------------------------------------
+// Features:
+// - event_init:        Initialize an event.
+// - event_set:         Signal the event.
+// - event_reset:       Clear the signal.
+// - event_is_set:      Check the signal without waiting.
+// - event_wait:        Block until signaled.
+// - event_wait_timed:  Block until signaled or the timeout elapses.
+// - event_destroy:     Clean up event resources.
+//
+// Function Signatures:
+// ----------------------------------------
+// void event_init(event_t *e, event_mode_t mode, int signaled);
+//     Example:
+//         event_t shutdown;
+//         event_init(&shutdown, EVENT_MANUAL_RESET, 0);
+//
+// void event_set(event_t *e);
+//     Example:
+//         event_set(&shutdown);
+//
+// void event_reset(event_t *e);
+//     Example:
+//         event_reset(&shutdown);
+//
+// int event_is_set(const event_t *e);
+//     Example:
+//         if (event_is_set(&shutdown)) { ... }
+//
+// void event_wait(event_t *e);
+//     Example:
+//         event_wait(&shutdown);
+//
+// int event_wait_timed(event_t *e, uint64_t timeout_ns);
+//     Example:
+//         if (event_wait_timed(&work, 1000000) == ETIMEDOUT) { ... }
+//
+// void event_destroy(event_t *e);
+//     Example:
+//         event_destroy(&shutdown);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: wait.h
+// ----------------------------------------
+
+#include <errno.h>
+#include "parking_lot.h"
+#include "wait.h"
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Pause-spins a waiter does before sleeping.
+ */
+#ifndef EVENT_SPIN_LIMIT
+#   define EVENT_SPIN_LIMIT 100
+#endif
+
+/**
+ * @brief Layout of event_t::word.
+ */
+#define EVENT_SIGNALED    1u   /**< The event is set */
+#define EVENT_MANUAL      2u   /**< Manual-reset mode */
+#define EVENT_WAITER_ONE  4u   /**< Increment of the sleeping-waiter count in bits 2..31 */
+
+/**
+ * @brief Reset behaviour of an event.
+ */
+typedef enum {
+    EVENT_AUTO_RESET = 0,  /**< A successful wait consumes the signal */
+    EVENT_MANUAL_RESET     /**< The signal persists until event_reset() */
+} event_mode_t;
+
+/**
+ * @brief Auto- or manual-reset event in one 32-bit word.
+ */
+typedef struct {
+    uint32_t word;  /**< EVENT_SIGNALED | EVENT_MANUAL | waiters * EVENT_WAITER_ONE */
+} event_t;
+
+/**
+ * @brief Initializes the event.
+ *
+ * @param e Pointer to the event_t structure to initialize.
+ * @param mode Auto- or manual-reset.
+ * @param signaled Non-zero to start in the signaled state.
+ */
+static inline void event_init(event_t *e, const event_mode_t mode, const int signaled) {
+    e->word = (mode == EVENT_MANUAL_RESET ? EVENT_MANUAL : 0u) | (signaled ? EVENT_SIGNALED : 0u);
+}
+
+/**
+ * @brief Signals the event.
+ *
+ * A manual-reset event wakes all sleepers; an auto-reset event wakes one.
+ * Setting an already signaled event has no effect.
+ *
+ * @param e Pointer to the event_t structure.
+ */
+static inline void event_set(event_t *e) {
+    uint32_t word = __atomic_load_n(&e->word, __ATOMIC_RELAXED);
+    do {
+        if (word & EVENT_SIGNALED) {
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&e->word, &word, word | EVENT_SIGNALED, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    if (word >= EVENT_WAITER_ONE) {
+        wake_n(&e->word, (word & EVENT_MANUAL) ? WAIT_ALL : 1);
+    }
+}
+
+/**
+ * @brief Clears the signal.
+ *
+ * @param e Pointer to the event_t structure.
+ */
+static inline void event_reset(event_t *e) {
+    __atomic_and_fetch(&e->word, ~EVENT_SIGNALED, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Checks the signal without waiting or consuming it.
+ *
+ * @param e Pointer to the event_t structure.
+ * @return 1 if the event is signaled, 0 otherwise.
+ */
+static inline int event_is_set(const event_t *e) {
+    return (__atomic_load_n(&e->word, __ATOMIC_ACQUIRE) & EVENT_SIGNALED) != 0;
+}
+
+/**
+ * @brief Waits for the signal, consuming it for auto-reset events.
+ *
+ * @param e Pointer to the event_t structure.
+ * @param timeout_ns Relative timeout, or PARKING_LOT_FOREVER.
+ * @return 0 once signaled, ETIMEDOUT on timeout.
+ */
+static inline int event_wait_timed(event_t *e, const uint64_t timeout_ns) {
+    const uint64_t start = timeout_ns == PARKING_LOT_FOREVER ? 0 : parking_lot_now_ns();
+    uint32_t registered = 0; // EVENT_WAITER_ONE once counted as a sleeper
+    int spins = 0;
+
+    for (;;) {
+        uint32_t word = __atomic_load_n(&e->word, __ATOMIC_ACQUIRE);
+
+        if (word & EVENT_SIGNALED) {
+            // Manual-reset events only drop our waiter count
+            const uint32_t consumed = (word & EVENT_MANUAL) ? word : (word & ~EVENT_SIGNALED);
+            if (consumed - registered == word
+                || __atomic_compare_exchange_n(&e->word, &word, consumed - registered, 1,
+                                               __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return 0;
+            }
+            continue;
+        }
+
+        if (spins < EVENT_SPIN_LIMIT) {
+            spins++;
+            mutex_cpu_relax();
+            continue;
+        }
+
+        uint64_t remaining = PARKING_LOT_FOREVER;
+        if (timeout_ns != PARKING_LOT_FOREVER) {
+            const uint64_t elapsed = parking_lot_now_ns() - start;
+            if (elapsed >= timeout_ns) {
+                if (registered) {
+                    __atomic_sub_fetch(&e->word, registered, __ATOMIC_RELAXED);
+                }
+                return ETIMEDOUT;
+            }
+            remaining = timeout_ns - elapsed;
+        }
+
+        if (!registered) {
+            if (!__atomic_compare_exchange_n(&e->word, &word, word + EVENT_WAITER_ONE, 1,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                continue;
+            }
+            registered = EVENT_WAITER_ONE;
+            word += EVENT_WAITER_ONE;
+        }
+        wait_on_address(&e->word, word, remaining);
+    }
+}
+
+/**
+ * @brief Waits for the signal, consuming it for auto-reset events.
+ *
+ * @param e Pointer to the event_t structure.
+ */
+static inline void event_wait(event_t *e) {
+    event_wait_timed(e, PARKING_LOT_FOREVER);
+}
+
+/**
+ * @brief Destroys the event.
+ *
+ * The event holds no resources; this exists for symmetry with mutex_t.
+ *
+ * @param e Pointer to the event_t structure to destroy.
+ */
+static inline void event_destroy(event_t *e) {
+    (void) e;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_EVENT_LIBRARY_H
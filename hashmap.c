@@ -0,0 +1,402 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hashmap.h"
+#include "spinlock.h"
+
+#ifdef _WIN32
+#   include <malloc.h>
+#endif
+
+/**
+ * @brief Entries stored inline per bucket; on 64-bit targets 7 fill two
+ * cache lines (the bucket is 128 bytes).
+ */
+#define HASHMAP_SLOTS 7
+
+/**
+ * @brief Alignment of tables, and offset of their first bucket.
+ */
+#define HASHMAP_LINE 64
+
+/**
+ * @brief Bit of bucket_t::used marking a bucket moved to the next table.
+ */
+#define HASHMAP_MOVED (1u << 31)
+
+/**
+ * @brief Buckets a writer migrates, besides its own, while a resize runs.
+ */
+#define HASHMAP_MIGRATE_STEP 4
+
+typedef struct {
+    spinlock_t lock;                  /**< Held by writers */
+    uint32_t version;                 /**< Odd while a writer modifies the bucket */
+    uint32_t used;                    /**< Occupied-slot bitmap | HASHMAP_MOVED */
+    uintptr_t keys[HASHMAP_SLOTS];
+    uintptr_t values[HASHMAP_SLOTS];
+} bucket_t;
+
+struct hashmap_table {
+    size_t mask;                      /**< Bucket count - 1 */
+    size_t migrate_next;              /**< Next bucket to claim while migrating away */
+    size_t migrated;                  /**< Buckets already moved to the next table */
+    hashmap_table_t *retired_next;    /**< Link in hashmap_t::retired */
+    char pad[HASHMAP_LINE - 3 * sizeof(size_t) - sizeof(void *)]; /**< Buckets start on a new line */
+    bucket_t buckets[];
+};
+
+// ============= TABLES =============
+static hashmap_table_t *table_alloc(const size_t nbuckets) {
+    const size_t bytes = sizeof(hashmap_table_t) + nbuckets * sizeof(bucket_t);
+#ifdef _WIN32
+    hashmap_table_t *t = (hashmap_table_t *) _aligned_malloc(bytes, HASHMAP_LINE);
+#else
+    hashmap_table_t *t = NULL;
+    if (posix_memalign((void **) &t, HASHMAP_LINE, bytes) != 0) {
+        t = NULL;
+    }
+#endif
+    if (t) {
+        // All-zero buckets are unlocked and empty
+        memset(t, 0, bytes);
+        t->mask = nbuckets - 1;
+    }
+    return t;
+}
+
+static void table_free(hashmap_table_t *t) {
+#ifdef _WIN32
+    _aligned_free(t);
+#else
+    free(t);
+#endif
+}
+
+static uint64_t hash_key(const uintptr_t key) {
+    uint64_t h = (uint64_t) key;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static bucket_t *bucket_in(hashmap_table_t *t, const uint64_t h) {
+    return &t->buckets[h & t->mask];
+}
+
+// ============= BUCKETS =============
+static void bucket_write_begin(bucket_t *b) {
+    __atomic_store_n(&b->version, b->version + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void bucket_write_end(bucket_t *b) {
+    __atomic_store_n(&b->version, b->version + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Optimistic, lock-free lookup in one bucket.
+ *
+ * @return 1 if found; *moved is set when the bucket has been migrated
+ *         and the answer must come from the next table.
+ */
+static int bucket_read(bucket_t *b, const uintptr_t key, uintptr_t *value, int *moved) {
+    for (;;) {
+        const uint32_t version = __atomic_load_n(&b->version, __ATOMIC_ACQUIRE);
+        if (version & 1) {
+            mutex_cpu_relax();
+            continue;
+        }
+
+        const uint32_t used = __atomic_load_n(&b->used, __ATOMIC_RELAXED);
+        int found = 0;
+        uintptr_t v = 0;
+        if (!(used & HASHMAP_MOVED)) {
+            for (uint32_t bits = used; bits; bits &= bits - 1) {
+                const int i = __builtin_ctz(bits);
+                if (__atomic_load_n(&b->keys[i], __ATOMIC_RELAXED) == key) {
+                    v = __atomic_load_n(&b->values[i], __ATOMIC_RELAXED);
+                    found = 1;
+                    break;
+                }
+            }
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&b->version, __ATOMIC_RELAXED) == version) {
+            *moved = (used & HASHMAP_MOVED) != 0;
+            if (found && value) {
+                *value = v;
+            }
+            return found;
+        }
+    }
+}
+
+/**
+ * @brief Slot holding key in a locked bucket, or -1.
+ */
+static int bucket_find(const bucket_t *b, const uintptr_t key) {
+    for (uint32_t bits = b->used & ~HASHMAP_MOVED; bits; bits &= bits - 1) {
+        const int i = __builtin_ctz(bits);
+        if (b->keys[i] == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void bucket_store(bucket_t *b, const int i, const uintptr_t key, const uintptr_t value) {
+    __atomic_store_n(&b->keys[i], key, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->values[i], value, __ATOMIC_RELAXED);
+    __atomic_store_n(&b->used, b->used | (1u << i), __ATOMIC_RELAXED);
+}
+
+// ============= MIGRATION =============
+/**
+ * @brief Moves a locked, not yet moved bucket of `from` into `to`.
+ *
+ * Lock order is always old bucket, then new bucket. A new bucket only
+ * receives entries from its single old bucket before that one is marked
+ * moved, and it starts empty, so there is always room.
+ */
+static void bucket_migrate(hashmap_t *m, hashmap_table_t *from, hashmap_table_t *to, bucket_t *ob) {
+    for (uint32_t bits = ob->used; bits; bits &= bits - 1) {
+        const int i = __builtin_ctz(bits);
+        bucket_t *nb = bucket_in(to, hash_key(ob->keys[i]));
+
+        spinlock_lock(&nb->lock);
+        bucket_write_begin(nb);
+        bucket_store(nb, __builtin_ctz(~nb->used), ob->keys[i], ob->values[i]);
+        bucket_write_end(nb);
+        spinlock_unlock(&nb->lock);
+    }
+
+    bucket_write_begin(ob);
+    __atomic_store_n(&ob->used, HASHMAP_MOVED, __ATOMIC_RELAXED);
+    bucket_write_end(ob);
+
+    if (__atomic_add_fetch(&from->migrated, 1, __ATOMIC_ACQ_REL) == from->mask + 1) {
+        // Last bucket moved: retire the table. Readers may still hold it.
+        hashmap_table_t *head = __atomic_load_n(&m->retired, __ATOMIC_RELAXED);
+        do {
+            from->retired_next = head;
+        } while (!__atomic_compare_exchange_n(&m->retired, &head, from, 1,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        __atomic_store_n(&m->old, NULL, __ATOMIC_RELEASE);
+    }
+}
+
+static void migrate_bucket_if_needed(hashmap_t *m, hashmap_table_t *from, hashmap_table_t *to, bucket_t *ob) {
+    if (__atomic_load_n(&ob->used, __ATOMIC_RELAXED) & HASHMAP_MOVED) {
+        return;
+    }
+    spinlock_lock(&ob->lock);
+    if (!(ob->used & HASHMAP_MOVED)) {
+        bucket_migrate(m, from, to, ob);
+    }
+    spinlock_unlock(&ob->lock);
+}
+
+/**
+ * @brief Claims and migrates up to `steps` buckets of a running resize.
+ */
+static void migrate_help(hashmap_t *m, hashmap_table_t *from, hashmap_table_t *to, const size_t steps) {
+    for (size_t n = 0; n < steps; n++) {
+        if (__atomic_load_n(&from->migrate_next, __ATOMIC_RELAXED) > from->mask) {
+            return;
+        }
+        const size_t i = __atomic_fetch_add(&from->migrate_next, 1, __ATOMIC_RELAXED);
+        if (i > from->mask) {
+            return;
+        }
+        migrate_bucket_if_needed(m, from, to, &from->buckets[i]);
+    }
+}
+
+/**
+ * @brief Doubles the table `seen`, unless another thread already did.
+ */
+static int hashmap_grow(hashmap_t *m, hashmap_table_t *seen) {
+    mutex_lock(&m->resize_lock);
+    hashmap_table_t *t = __atomic_load_n(&m->table, __ATOMIC_ACQUIRE);
+    if (t != seen) {
+        mutex_unlock(&m->resize_lock);
+        return 0;
+    }
+
+    // One migration at a time: finish the previous one first
+    hashmap_table_t *old = __atomic_load_n(&m->old, __ATOMIC_ACQUIRE);
+    if (old) {
+        migrate_help(m, old, t, SIZE_MAX);
+        while (__atomic_load_n(&m->old, __ATOMIC_ACQUIRE) != NULL) {
+            mutex_thread_yield();
+        }
+    }
+
+    hashmap_table_t *next = table_alloc((t->mask + 1) * 2);
+    if (!next) {
+        mutex_unlock(&m->resize_lock);
+        return ENOMEM;
+    }
+    // Publish the old table before the new one so readers never miss it
+    __atomic_store_n(&m->old, t, __ATOMIC_RELEASE);
+    __atomic_store_n(&m->table, next, __ATOMIC_RELEASE);
+    mutex_unlock(&m->resize_lock);
+    return 0;
+}
+
+/**
+ * @brief Locks the authoritative bucket for a key, migrating it first if needed.
+ */
+static bucket_t *writer_lock(hashmap_t *m, const uint64_t h, hashmap_table_t **table) {
+    for (;;) {
+        hashmap_table_t *t = __atomic_load_n(&m->table, __ATOMIC_ACQUIRE);
+        hashmap_table_t *old = __atomic_load_n(&m->old, __ATOMIC_ACQUIRE);
+        if (old && old != t) {
+            migrate_help(m, old, t, HASHMAP_MIGRATE_STEP);
+            migrate_bucket_if_needed(m, old, t, bucket_in(old, h));
+        }
+
+        bucket_t *b = bucket_in(t, h);
+        spinlock_lock(&b->lock);
+        if (!(b->used & HASHMAP_MOVED)) {
+            *table = t;
+            return b;
+        }
+        // t itself has been replaced and this bucket moved on
+        spinlock_unlock(&b->lock);
+    }
+}
+
+// ============= PUBLIC API =============
+int hashmap_init(hashmap_t *m, const size_t capacity) {
+    // Aim for half-full buckets
+    size_t nbuckets = 1;
+    while (nbuckets * (HASHMAP_SLOTS / 2) < capacity) {
+        nbuckets <<= 1;
+    }
+
+    m->table = table_alloc(nbuckets);
+    if (!m->table) {
+        return ENOMEM;
+    }
+    m->old = NULL;
+    m->retired = NULL;
+    mutex_init(&m->resize_lock);
+    return 0;
+}
+
+int hashmap_get(hashmap_t *m, const uintptr_t key, uintptr_t *value) {
+    const uint64_t h = hash_key(key);
+    for (;;) {
+        hashmap_table_t *t = __atomic_load_n(&m->table, __ATOMIC_ACQUIRE);
+        hashmap_table_t *old = __atomic_load_n(&m->old, __ATOMIC_ACQUIRE);
+        int moved;
+
+        // An old bucket not yet moved is still authoritative for its keys
+        if (old && old != t) {
+            const int found = bucket_read(bucket_in(old, h), key, value, &moved);
+            if (!moved) {
+                return found;
+            }
+        }
+
+        const int found = bucket_read(bucket_in(t, h), key, value, &moved);
+        if (!moved) {
+            return found;
+        }
+    }
+}
+
+int hashmap_put(hashmap_t *m, const uintptr_t key, const uintptr_t value) {
+    const uint64_t h = hash_key(key);
+    for (;;) {
+        hashmap_table_t *t;
+        bucket_t *b = writer_lock(m, h, &t);
+
+        int i = bucket_find(b, key);
+        if (i < 0 && b->used != (1u << HASHMAP_SLOTS) - 1) {
+            i = __builtin_ctz(~b->used);
+        }
+        if (i >= 0) {
+            bucket_write_begin(b);
+            bucket_store(b, i, key, value);
+            bucket_write_end(b);
+            spinlock_unlock(&b->lock);
+            return 0;
+        }
+
+        spinlock_unlock(&b->lock);
+        const int rc = hashmap_grow(m, t);
+        if (rc) {
+            return rc;
+        }
+    }
+}
+
+int hashmap_remove(hashmap_t *m, const uintptr_t key, uintptr_t *value) {
+    const uint64_t h = hash_key(key);
+    hashmap_table_t *t;
+    bucket_t *b = writer_lock(m, h, &t);
+
+    const int i = bucket_find(b, key);
+    if (i >= 0) {
+        if (value) {
+            *value = b->values[i];
+        }
+        bucket_write_begin(b);
+        __atomic_store_n(&b->used, b->used & ~(1u << i), __ATOMIC_RELAXED);
+        bucket_write_end(b);
+    }
+    spinlock_unlock(&b->lock);
+    return i >= 0;
+}
+
+static size_t table_count(hashmap_table_t *t) {
+    size_t count = 0;
+    for (size_t i = 0; i <= t->mask; i++) {
+        const uint32_t used = __atomic_load_n(&t->buckets[i].used, __ATOMIC_RELAXED);
+        if (!(used & HASHMAP_MOVED)) {
+            count += (size_t) __builtin_popcount(used);
+        }
+    }
+    return count;
+}
+
+size_t hashmap_size(hashmap_t *m) {
+    hashmap_table_t *t = __atomic_load_n(&m->table, __ATOMIC_ACQUIRE);
+    hashmap_table_t *old = __atomic_load_n(&m->old, __ATOMIC_ACQUIRE);
+    size_t count = table_count(t);
+    if (old && old != t) {
+        count += table_count(old);
+    }
+    return count;
+}
+
+void hashmap_destroy(hashmap_t *m) {
+    table_free(m->old);
+    table_free(m->table);
+    for (hashmap_table_t *t = m->retired; t;) {
+        hashmap_table_t *next = t->retired_next;
+        table_free(t);
+        t = next;
+    }
+    m->table = NULL;
+    m->old = NULL;
+    m->retired = NULL;
+    mutex_destroy(&m->resize_lock);
+}
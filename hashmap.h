@@ -0,0 +1,162 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_HASHMAP_LIBRARY_H
+#define FLUENT_LIBC_HASHMAP_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// hashmap_t API
+// ----------------------------------------
+// Concurrent hash map from word-sized keys to word-sized values
+// (integers, handles, interned pointers).
+//
+// - The table is an array of small buckets holding seven entries
+//   inline. Each bucket has its own spinlock_t, so writers contend only
+//   when they hit the same bucket.
+// - Lookups take no lock. Each bucket carries a version number that
+//   writers make odd while they modify it (a seqlock); a reader copies
+//   the entry it needs and retries if the version moved.
+// - When a bucket overflows, the table doubles without stopping the
+//   world. Buckets move to the new table one at a time: every writer
+//   first moves the bucket its key lives in plus a few more, and readers
+//   follow a "moved" mark to the new table. Replaced tables are kept
+//   until hashmap_destroy() because lock-free readers may still be
+//   looking at them. Their total size stays below the live table's.
+//
+// Keys are compared by value, so pointer keys must be interned.
+// ----------------------------------------
+// Features:
+// - hashmap_init:     Initialize a map with a capacity hint.
+// - hashmap_get:      Look up a key without locking.
+// - hashmap_put:      Insert or replace a key.
+// - hashmap_remove:   Delete a key.
+// - hashmap_size:     Approximate number of entries.
+// - hashmap_destroy:  Release map memory.
+//
+// Function Signatures:
+// ----------------------------------------
+// int hashmap_init(hashmap_t *m, size_t capacity);
+//     Example:
+//         hashmap_t sessions;
+//         hashmap_init(&sessions, 4096);
+//
+// int hashmap_get(hashmap_t *m, uintptr_t key, uintptr_t *value);
+//     Example:
+//         uintptr_t v;
+//         if (hashmap_get(&sessions, id, &v)) { ... }
+//
+// int hashmap_put(hashmap_t *m, uintptr_t key, uintptr_t value);
+//     Example:
+//         hashmap_put(&sessions, id, (uintptr_t) session);
+//
+// int hashmap_remove(hashmap_t *m, uintptr_t key, uintptr_t *value);
+//     Example:
+//         hashmap_remove(&sessions, id, NULL);
+//
+// size_t hashmap_size(hashmap_t *m);
+//     Example:
+//         printf("%zu sessions\n", hashmap_size(&sessions));
+//
+// void hashmap_destroy(hashmap_t *m);
+//     Example:
+//         hashmap_destroy(&sessions);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h, spinlock.h
+// ----------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Bucket array of one table generation (opaque).
+ */
+typedef struct hashmap_table hashmap_table_t;
+
+/**
+ * @brief Concurrent hash map.
+ */
+typedef struct {
+    hashmap_table_t *table;    /**< Live table */
+    hashmap_table_t *old;      /**< Table being migrated from, or NULL */
+    hashmap_table_t *retired;  /**< Fully migrated tables, freed on destroy */
+    mutex_t resize_lock;       /**< Serializes the start of migrations */
+} hashmap_t;
+
+/**
+ * @brief Initializes the map.
+ *
+ * @param m Pointer to the hashmap_t structure to initialize.
+ * @param capacity Expected number of entries; the map grows past it as needed.
+ * @return 0 on success, ENOMEM on allocation failure.
+ */
+int hashmap_init(hashmap_t *m, size_t capacity);
+
+/**
+ * @brief Looks up a key without taking any lock.
+ *
+ * @param m Pointer to the hashmap_t structure.
+ * @param key Key to look up.
+ * @param value Receives the value if found; may be NULL.
+ * @return 1 if the key is present, 0 otherwise.
+ */
+int hashmap_get(hashmap_t *m, uintptr_t key, uintptr_t *value);
+
+/**
+ * @brief Inserts a key or replaces its value.
+ *
+ * @param m Pointer to the hashmap_t structure.
+ * @param key Key to insert.
+ * @param value Value to store.
+ * @return 0 on success, ENOMEM if the table had to grow and could not.
+ */
+int hashmap_put(hashmap_t *m, uintptr_t key, uintptr_t value);
+
+/**
+ * @brief Deletes a key.
+ *
+ * @param m Pointer to the hashmap_t structure.
+ * @param key Key to delete.
+ * @param value Receives the removed value if found; may be NULL.
+ * @return 1 if the key was present, 0 otherwise.
+ */
+int hashmap_remove(hashmap_t *m, uintptr_t key, uintptr_t *value);
+
+/**
+ * @brief Counts the entries.
+ *
+ * Walks every bucket; exact only while no writer is active.
+ *
+ * @param m Pointer to the hashmap_t structure.
+ * @return Number of entries.
+ */
+size_t hashmap_size(hashmap_t *m);
+
+/**
+ * @brief Destroys the map. No other thread may use it concurrently.
+ *
+ * @param m Pointer to the hashmap_t structure to destroy.
+ */
+void hashmap_destroy(hashmap_t *m);
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_HASHMAP_LIBRARY_H
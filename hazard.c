@@ -0,0 +1,172 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hazard.h"
+#include "thread_registry.h"
+
+static thread_registry_t records = THREAD_REGISTRY_INIT(hazard_record_t, next, next_free, "hazard");
+static FLUENT_LIBC_THREAD_LOCAL hazard_record_t *record = NULL;
+
+// ============= SCAN =============
+static int pointer_cmp(const void *a, const void *b) {
+    const uintptr_t x = (uintptr_t) *(void *const *) a;
+    const uintptr_t y = (uintptr_t) *(void *const *) b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Retired-list length that triggers a scan: twice the hazards in
+ * existence, so every scan frees at least half of the list.
+ */
+static size_t hazard_threshold(void) {
+    const size_t total = __atomic_load_n(&records.count, __ATOMIC_RELAXED) * HAZARD_SLOTS;
+    return 2 * total > HAZARD_RETIRE_MIN ? 2 * total : HAZARD_RETIRE_MIN;
+}
+
+/**
+ * @brief Copies every published hazard into self->snapshot, sorted.
+ *
+ * @return Number of hazards, or (size_t) -1 if the buffer could not grow.
+ */
+static size_t hazard_snapshot(hazard_record_t *self) {
+    // Pairs with hazard_protect's fence: our unlinks precede these reads
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    size_t n = 0;
+    for (hazard_record_t *r = (hazard_record_t *) __atomic_load_n(&records.head, __ATOMIC_ACQUIRE); r; r = r->next) {
+        for (unsigned i = 0; i < HAZARD_SLOTS; i++) {
+            void *p = __atomic_load_n(&r->h.slots[i], __ATOMIC_ACQUIRE);
+            if (!p) {
+                continue;
+            }
+            if (n == self->snapshot_cap) {
+                const size_t cap = self->snapshot_cap ? self->snapshot_cap * 2 : 4 * HAZARD_SLOTS;
+                void **grown = (void **) realloc(self->snapshot, cap * sizeof(void *));
+                if (!grown) {
+                    return (size_t) -1;
+                }
+                self->snapshot = grown;
+                self->snapshot_cap = cap;
+            }
+            self->snapshot[n++] = p;
+        }
+    }
+    qsort(self->snapshot, n, sizeof(void *), pointer_cmp);
+    return n;
+}
+
+static void hazard_scan_record(hazard_record_t *self) {
+    const size_t hazards = hazard_snapshot(self);
+    if (hazards == (size_t) -1) {
+        return;
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < self->retired_count; i++) {
+        hazard_retired_t *r = &self->retired[i];
+        if (hazards && bsearch(&r->ptr, self->snapshot, hazards, sizeof(void *), pointer_cmp)) {
+            self->retired[kept++] = *r;
+        } else {
+            r->reclaim(r->ptr);
+        }
+    }
+    self->retired_count = kept;
+}
+
+// ============= THREAD RECORDS =============
+#ifndef _WIN32
+static pthread_key_t record_key;
+static pthread_once_t record_once = PTHREAD_ONCE_INIT;
+
+static void hazard_record_release(void *arg) {
+    hazard_record_t *self = (hazard_record_t *) arg;
+    for (unsigned i = 0; i < HAZARD_SLOTS; i++) {
+        __atomic_store_n(&self->h.slots[i], NULL, __ATOMIC_RELEASE);
+    }
+    // Objects still protected elsewhere move on with the record
+    hazard_scan_record(self);
+    thread_registry_give_back(&records, self);
+}
+
+static void hazard_record_key_create(void) {
+    pthread_key_create(&record_key, hazard_record_release);
+}
+#endif
+
+hazard_record_t *hazard_thread_record(void) {
+    hazard_record_t *self = record;
+    if (self) {
+        return self;
+    }
+
+    self = (hazard_record_t *) thread_registry_take(&records);
+
+#ifndef _WIN32
+    // Recycle the record at thread exit (Windows threads keep theirs)
+    pthread_once(&record_once, hazard_record_key_create);
+    pthread_setspecific(record_key, self);
+#endif
+    record = self;
+    return self;
+}
+
+// ============= RETIRE =============
+/**
+ * @brief Retires an object that does not fit on the full retired list.
+ *
+ * Every listed object is still protected, so waiting for a scan could
+ * wait forever (the caller may hold one of those hazards itself).
+ * Reclaims the object now when nobody protects it, else aborts: it can
+ * neither be freed nor remembered.
+ */
+static void hazard_retire_unqueued(hazard_record_t *self, void *ptr, void (*reclaim)(void *)) {
+    const size_t hazards = hazard_snapshot(self);
+    if (hazards != (size_t) -1
+        && !(hazards && bsearch(&ptr, self->snapshot, hazards, sizeof(void *), pointer_cmp))) {
+        reclaim(ptr);
+        return;
+    }
+    fprintf(stderr, "hazard: out of memory retiring a protected object\n");
+    abort();
+}
+
+void hazard_retire(void *ptr, void (*reclaim)(void *)) {
+    hazard_record_t *self = hazard_self();
+
+    if (self->retired_count == self->retired_cap) {
+        const size_t cap = self->retired_cap ? self->retired_cap * 2 : HAZARD_RETIRE_MIN;
+        hazard_retired_t *grown = (hazard_retired_t *) realloc(self->retired, cap * sizeof(hazard_retired_t));
+        if (grown) {
+            self->retired = grown;
+            self->retired_cap = cap;
+        } else {
+            // No memory to defer: make room, or reclaim this one on the spot
+            hazard_scan_record(self);
+            if (self->retired_count == self->retired_cap) {
+                hazard_retire_unqueued(self, ptr, reclaim);
+                return;
+            }
+        }
+    }
+
+    self->retired[self->retired_count].ptr = ptr;
+    self->retired[self->retired_count].reclaim = reclaim;
+    self->retired_count++;
+
+    if (self->retired_count >= hazard_threshold()) {
+        hazard_scan_record(self);
+    }
+}
+
+void hazard_scan(void) {
+    hazard_scan_record(hazard_self());
+}
@@ -0,0 +1,220 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_HAZARD_LIBRARY_H
+#define FLUENT_LIBC_HAZARD_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// hazard pointer API
+// ----------------------------------------
+// Hazard-pointer memory reclamation (Michael, 2004). A reader publishes
+// each pointer it is about to dereference in one of its HAZARD_SLOTS
+// hazard slots. A writer retires unlinked objects, and an object is freed
+// only when no slot holds it.
+//
+// Unlike epochs (ebr.h), a reader that stalls, even one blocked on I/O,
+// pins only the objects in its own slots. Garbage therefore stays
+// bounded: each thread keeps at most about max(HAZARD_RETIRE_MIN,
+// 2 * total slots) retired objects. When a thread's list reaches that
+// threshold it scans: it takes a sorted snapshot of every published
+// hazard, then frees each retired object not found by binary search. At
+// least half of the list is freed per scan, so the cost per retire stays
+// constant.
+//
+// Protecting a pointer costs one store, one full fence and a re-load of
+// the source. Clearing a slot is one store.
+// ----------------------------------------
+// Features:
+// - hazard_protect:    Publish and validate a pointer loaded from a shared location.
+// - hazard_set:        Publish a pointer already known to be reachable.
+// - hazard_clear:      Drop one hazard.
+// - hazard_clear_all:  Drop every hazard of the calling thread.
+// - hazard_retire:     Defer reclamation of an unlinked object.
+// - hazard_scan:       Free every retired object not currently protected.
+//
+// Function Signatures:
+// ----------------------------------------
+// void *hazard_protect(unsigned slot, void *const *src);
+//     Example:
+//         node_t *n = (node_t *) hazard_protect(0, (void *const *) &list->head);
+//         if (n) { use(n->value); }
+//         hazard_clear(0);
+//
+// void hazard_set(unsigned slot, void *ptr);
+//     Example:
+//         hazard_set(1, next);
+//
+// void hazard_clear(unsigned slot);
+//     Example:
+//         hazard_clear(0);
+//
+// void hazard_clear_all(void);
+//     Example:
+//         hazard_clear_all();
+//
+// void hazard_retire(void *ptr, void (*reclaim)(void *));
+//     Example:
+//         hazard_retire(old, free);
+//
+// void hazard_scan(void);
+//     Example:
+//         hazard_scan();
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h, thread_registry.h
+// ----------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Hazard slots per thread.
+ */
+#ifndef HAZARD_SLOTS
+#   define HAZARD_SLOTS 4u
+#endif
+
+/**
+ * @brief Smallest retired-list length that triggers a scan.
+ */
+#ifndef HAZARD_RETIRE_MIN
+#   define HAZARD_RETIRE_MIN 64u
+#endif
+
+/**
+ * @brief An object waiting for reclamation.
+ */
+typedef struct {
+    void *ptr;                 /**< The retired object */
+    void (*reclaim)(void *);   /**< Frees it */
+} hazard_retired_t;
+
+/**
+ * @brief Per-thread hazard record, cache-line aligned. Slots are read by
+ * every scanning thread and fill the first line; the rest is private to
+ * the owner.
+ */
+typedef struct hazard_record {
+    union {
+        void *slots[HAZARD_SLOTS];     /**< Published hazards, NULL when unused */
+        char pad[64];
+    } h;
+    struct hazard_record *next;        /**< Registry link; records are never freed */
+    struct hazard_record *next_free;   /**< Link in the recycled-record list */
+    hazard_retired_t *retired;         /**< Objects waiting for a scan */
+    size_t retired_count;
+    size_t retired_cap;
+    void **snapshot;                   /**< Scan buffer */
+    size_t snapshot_cap;
+} hazard_record_t;
+
+/**
+ * @brief Returns the calling thread's record, registering it on first use.
+ */
+hazard_record_t *hazard_thread_record(void);
+
+/**
+ * @brief Defers reclamation of an object that is no longer reachable.
+ *
+ * The object must already be unlinked from every shared structure.
+ * `reclaim(ptr)` runs once no hazard slot holds `ptr`; it must not
+ * retire further objects. When the retired list cannot grow, `ptr` is
+ * reclaimed immediately if unprotected; otherwise the process aborts.
+ *
+ * @param ptr The unlinked object.
+ * @param reclaim Frees it.
+ */
+void hazard_retire(void *ptr, void (*reclaim)(void *));
+
+/**
+ * @brief Frees every object this thread retired that no slot protects.
+ */
+void hazard_scan(void);
+
+static inline hazard_record_t *hazard_self(void) {
+    static FLUENT_LIBC_THREAD_LOCAL hazard_record_t *self = NULL;
+    if (!self) {
+        self = hazard_thread_record();
+    }
+    return self;
+}
+
+/**
+ * @brief Loads `*src` and protects the loaded pointer.
+ *
+ * Retries until the published hazard matches the current value of
+ * `*src`, so the returned object cannot have been freed.
+ *
+ * @param slot Hazard slot, in [0, HAZARD_SLOTS).
+ * @param src Shared location holding the pointer.
+ * @return The protected pointer (possibly NULL).
+ */
+static inline void *hazard_protect(const unsigned slot, void *const *src) {
+    void **hazard = &hazard_self()->h.slots[slot];
+    void *ptr = __atomic_load_n(src, __ATOMIC_RELAXED);
+    for (;;) {
+        __atomic_store_n(hazard, ptr, __ATOMIC_RELAXED);
+        // The hazard must be visible before src is re-checked
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        void *again = __atomic_load_n(src, __ATOMIC_ACQUIRE);
+        if (again == ptr) {
+            return ptr;
+        }
+        ptr = again;
+    }
+}
+
+/**
+ * @brief Publishes a pointer in a slot without validation.
+ *
+ * The caller must re-check that `ptr` is still reachable afterwards
+ * (e.g. that the predecessor still links to it).
+ *
+ * @param slot Hazard slot, in [0, HAZARD_SLOTS).
+ * @param ptr Pointer to protect.
+ */
+static inline void hazard_set(const unsigned slot, void *ptr) {
+    __atomic_store_n(&hazard_self()->h.slots[slot], ptr, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Drops the hazard in one slot.
+ *
+ * @param slot Hazard slot, in [0, HAZARD_SLOTS).
+ */
+static inline void hazard_clear(const unsigned slot) {
+    __atomic_store_n(&hazard_self()->h.slots[slot], NULL, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Drops every hazard of the calling thread.
+ */
+static inline void hazard_clear_all(void) {
+    hazard_record_t *self = hazard_self();
+    for (unsigned i = 0; i < HAZARD_SLOTS; i++) {
+        __atomic_store_n(&self->h.slots[i], NULL, __ATOMIC_RELEASE);
+    }
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_HAZARD_LIBRARY_H
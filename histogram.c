@@ -0,0 +1,589 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "histogram.h"
+#include "mutex.h"
+#include "spinlock.h"
+
+/**
+ * @brief One thread's counts. The counters follow the header.
+ */
+typedef struct histogram_shard {
+    struct histogram_shard *next;
+    int claimed;          // 1 while a thread records into it
+    uint64_t counts[];
+} histogram_shard_t;
+
+/**
+ * @brief The shard a thread records into for one histogram.
+ */
+typedef struct {
+    histogram_t *hist;
+    uint64_t id;          // hist->id when the entry was claimed
+    histogram_shard_t *shard;
+} histogram_cache_t;
+
+// Interchange format cookies (V2, 8-byte word size bit set)
+#define HISTOGRAM_ENCODING_COOKIE 0x1c849313u
+#define HISTOGRAM_COMPRESSED_COOKIE 0x1c849314u
+#define HISTOGRAM_HEADER_BYTES 40u
+
+static uint64_t next_histogram_id = 0;
+
+// Initialized histograms; shards are only given back to histograms listed here
+static spinlock_t live_guard = SPINLOCK_INIT;
+static histogram_t *live = NULL;
+
+static FLUENT_LIBC_THREAD_LOCAL histogram_cache_t caches[HISTOGRAM_THREAD_CACHES];
+static FLUENT_LIBC_THREAD_LOCAL uint32_t cache_victim = 0;
+static FLUENT_LIBC_THREAD_LOCAL int cache_registered = 0;
+
+// ============= LAYOUT =============
+static int layout_init(histogram_layout_t *l, const uint64_t highest, const int digits) {
+    if (digits < 1 || digits > 5 || highest < 2) {
+        return EINVAL;
+    }
+
+    uint64_t largest_single_unit = 2;
+    for (int i = 0; i < digits; i++) {
+        largest_single_unit *= 10;
+    }
+    uint32_t magnitude = 0;
+    while (((uint64_t) 1 << magnitude) < largest_single_unit) {
+        magnitude++;
+    }
+
+    l->highest = highest;
+    l->digits = digits;
+    l->half_magnitude = magnitude - 1;
+    l->sub_bucket_count = (uint32_t) 1 << magnitude;
+
+    uint64_t smallest_untrackable = l->sub_bucket_count;
+    uint32_t buckets = 1;
+    while (smallest_untrackable <= highest) {
+        if (smallest_untrackable > UINT64_MAX / 2) {
+            buckets++;
+            break;
+        }
+        smallest_untrackable <<= 1;
+        buckets++;
+    }
+    l->bucket_count = buckets;
+    l->counts_len = (size_t) (buckets + 1) * (l->sub_bucket_count / 2);
+    return 0;
+}
+
+static uint32_t layout_bucket(const histogram_layout_t *l, const uint64_t value) {
+    const uint64_t v = value | (l->sub_bucket_count - 1);
+    return (uint32_t) (64 - __builtin_clzll(v)) - (l->half_magnitude + 1);
+}
+
+static size_t layout_index(const histogram_layout_t *l, const uint64_t value) {
+    const uint32_t bucket = layout_bucket(l, value);
+    const uint64_t sub_bucket = value >> bucket;
+    return ((size_t) (bucket + 1) << l->half_magnitude) + (size_t) sub_bucket - l->sub_bucket_count / 2;
+}
+
+/**
+ * @brief Lowest value counted at `index`, and the width of its bucket.
+ */
+static uint64_t layout_value(const histogram_layout_t *l, const size_t index, uint64_t *width) {
+    const uint32_t half_count = l->sub_bucket_count / 2;
+    int64_t bucket = (int64_t) (index >> l->half_magnitude) - 1;
+    uint64_t sub_bucket = (index & (half_count - 1)) + half_count;
+    if (bucket < 0) {
+        sub_bucket -= half_count;
+        bucket = 0;
+    }
+    *width = (uint64_t) 1 << bucket;
+    return sub_bucket << bucket;
+}
+
+static uint64_t layout_highest_equivalent(const histogram_layout_t *l, const size_t index) {
+    uint64_t width;
+    const uint64_t lowest = layout_value(l, index, &width);
+    return lowest + width - 1;
+}
+
+static uint64_t layout_median_equivalent(const histogram_layout_t *l, const size_t index) {
+    uint64_t width;
+    const uint64_t lowest = layout_value(l, index, &width);
+    return lowest + width / 2;
+}
+
+// ============= THREAD CACHES =============
+/**
+ * @brief Hands a cache's shard back to its histogram, unless the
+ * histogram was destroyed, and empties the entry.
+ */
+static void cache_release_entry(histogram_cache_t *c) {
+    if (c->shard) {
+        spinlock_lock(&live_guard);
+        for (const histogram_t *h = live; h; h = h->next_live) {
+            if (h == c->hist && h->id == c->id) {
+                __atomic_store_n(&c->shard->claimed, 0, __ATOMIC_RELEASE);
+                break;
+            }
+        }
+        spinlock_unlock(&live_guard);
+    }
+    c->hist = NULL;
+    c->id = 0;
+    c->shard = NULL;
+}
+
+#ifndef _WIN32
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static void cache_release(void *arg) {
+    histogram_cache_t *mine = (histogram_cache_t *) arg;
+    for (uint32_t i = 0; i < HISTOGRAM_THREAD_CACHES; i++) {
+        cache_release_entry(&mine[i]);
+    }
+}
+
+static void cache_key_create(void) {
+    pthread_key_create(&cache_key, cache_release);
+}
+#endif
+
+/**
+ * @brief Claims a free shard of `h`, or adds a new one.
+ */
+static histogram_shard_t *shard_claim(histogram_t *h) {
+    for (histogram_shard_t *s = __atomic_load_n(&h->shards, __ATOMIC_ACQUIRE); s; s = s->next) {
+        int expected = 0;
+        if (__atomic_load_n(&s->claimed, __ATOMIC_RELAXED) == 0
+            && __atomic_compare_exchange_n(&s->claimed, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return s;
+        }
+    }
+
+    histogram_shard_t *s = (histogram_shard_t *) calloc(1, sizeof(histogram_shard_t)
+                                                           + h->layout.counts_len * sizeof(uint64_t));
+    if (!s) {
+        return NULL;
+    }
+    s->claimed = 1;
+    histogram_shard_t *head = __atomic_load_n(&h->shards, __ATOMIC_RELAXED);
+    do {
+        s->next = head;
+    } while (!__atomic_compare_exchange_n(&h->shards, &head, s, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return s;
+}
+
+static histogram_cache_t *cache_claim(histogram_cache_t *c, histogram_t *h) {
+    c->shard = shard_claim(h);
+    if (!c->shard) {
+        return NULL;
+    }
+    c->hist = h;
+    c->id = h->id;
+    if (!cache_registered) {
+#ifndef _WIN32
+        // Give shards back at thread exit (Windows threads keep theirs)
+        pthread_once(&cache_once, cache_key_create);
+        pthread_setspecific(cache_key, caches);
+#endif
+        cache_registered = 1;
+    }
+    return c;
+}
+
+static histogram_cache_t *cache_for(histogram_t *h) {
+    for (uint32_t i = 0; i < HISTOGRAM_THREAD_CACHES; i++) {
+        histogram_cache_t *c = &caches[i];
+        if (c->hist == h) {
+            if (c->id == h->id) {
+                return c;
+            }
+            // Left over from a destroyed histogram at the same address
+            cache_release_entry(c);
+            return cache_claim(c, h);
+        }
+    }
+    for (uint32_t i = 0; i < HISTOGRAM_THREAD_CACHES; i++) {
+        if (!caches[i].hist) {
+            return cache_claim(&caches[i], h);
+        }
+    }
+
+    histogram_cache_t *c = &caches[cache_victim++ % HISTOGRAM_THREAD_CACHES];
+    cache_release_entry(c);
+    return cache_claim(c, h);
+}
+
+// ============= RECORDING =============
+int histogram_init(histogram_t *h, const uint64_t highest, const int digits) {
+    const int err = layout_init(&h->layout, highest, digits);
+    if (err != 0) {
+        return err;
+    }
+    h->id = __atomic_add_fetch(&next_histogram_id, 1, __ATOMIC_RELAXED);
+    h->shards = NULL;
+
+    spinlock_lock(&live_guard);
+    h->next_live = live;
+    live = h;
+    spinlock_unlock(&live_guard);
+    return 0;
+}
+
+void histogram_record(histogram_t *h, uint64_t value) {
+    const histogram_cache_t *c = cache_for(h);
+    if (!c) {
+        return;
+    }
+    if (value > h->layout.highest) {
+        value = h->layout.highest;
+    }
+    // Only this thread writes the shard; readers may load it concurrently
+    uint64_t *count = &c->shard->counts[layout_index(&h->layout, value)];
+    __atomic_store_n(count, __atomic_load_n(count, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+}
+
+void histogram_destroy(histogram_t *h) {
+    spinlock_lock(&live_guard);
+    for (histogram_t **link = &live; *link; link = &(*link)->next_live) {
+        if (*link == h) {
+            *link = h->next_live;
+            break;
+        }
+    }
+    spinlock_unlock(&live_guard);
+
+    histogram_shard_t *s = h->shards;
+    while (s) {
+        histogram_shard_t *next = s->next;
+        free(s);
+        s = next;
+    }
+    h->shards = NULL;
+    h->id = 0;
+}
+
+// ============= SNAPSHOTS =============
+int histogram_snapshot(const histogram_t *h, histogram_snapshot_t *out) {
+    out->layout = h->layout;
+    out->total = 0;
+    out->counts = (uint64_t *) calloc(h->layout.counts_len, sizeof(uint64_t));
+    if (!out->counts) {
+        return ENOMEM;
+    }
+
+    for (histogram_shard_t *s = __atomic_load_n(&((histogram_t *) h)->shards, __ATOMIC_ACQUIRE); s; s = s->next) {
+        for (size_t i = 0; i < h->layout.counts_len; i++) {
+            const uint64_t n = __atomic_load_n(&s->counts[i], __ATOMIC_RELAXED);
+            out->counts[i] += n;
+            out->total += n;
+        }
+    }
+    return 0;
+}
+
+void histogram_snapshot_free(histogram_snapshot_t *s) {
+    free(s->counts);
+    s->counts = NULL;
+    s->total = 0;
+}
+
+uint64_t histogram_percentile(const histogram_snapshot_t *s, double percentile) {
+    if (s->total == 0) {
+        return 0;
+    }
+    if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    uint64_t wanted = (uint64_t) (percentile / 100.0 * (double) s->total + 0.5);
+    if (wanted < 1) {
+        wanted = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < s->layout.counts_len; i++) {
+        seen += s->counts[i];
+        if (seen >= wanted) {
+            return layout_highest_equivalent(&s->layout, i);
+        }
+    }
+    return 0;
+}
+
+double histogram_mean(const histogram_snapshot_t *s) {
+    if (s->total == 0) {
+        return 0;
+    }
+    double sum = 0;
+    for (size_t i = 0; i < s->layout.counts_len; i++) {
+        if (s->counts[i]) {
+            sum += (double) layout_median_equivalent(&s->layout, i) * (double) s->counts[i];
+        }
+    }
+    return sum / (double) s->total;
+}
+
+uint64_t histogram_max(const histogram_snapshot_t *s) {
+    for (size_t i = s->layout.counts_len; i > 0; i--) {
+        if (s->counts[i - 1]) {
+            return layout_highest_equivalent(&s->layout, i - 1);
+        }
+    }
+    return 0;
+}
+
+// ============= TEXT OUTPUT =============
+/**
+ * @brief snprintf-style appender that keeps counting past the end.
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} text_out_t;
+
+static void text_printf(text_out_t *out, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const size_t room = out->len < out->size ? out->size - out->len : 0;
+    const int n = vsnprintf(room ? out->buf + out->len : NULL, room, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        out->len += (size_t) n;
+    }
+}
+
+static double histogram_sqrt(const double x) {
+    if (x <= 0) {
+        return 0;
+    }
+    double r = x > 1 ? x : 1;
+    for (int i = 0; i < 64; i++) {
+        r = 0.5 * (r + x / r);
+    }
+    return r;
+}
+
+static void text_line(text_out_t *out, const histogram_snapshot_t *s, const double unit_ratio,
+                      const size_t index, const double percentile, const uint64_t seen) {
+    const double value = (double) layout_highest_equivalent(&s->layout, index) / unit_ratio;
+    if (percentile < 100.0) {
+        text_printf(out, "%12.*f %2.12f %10llu %14.2f\n", s->layout.digits, value, percentile / 100.0,
+                    (unsigned long long) seen, 1.0 / (1.0 - percentile / 100.0));
+    } else {
+        text_printf(out, "%12.*f %2.12f %10llu\n", s->layout.digits, value, 1.0, (unsigned long long) seen);
+    }
+}
+
+size_t histogram_format(const histogram_snapshot_t *s, double unit_ratio, char *buf, const size_t size) {
+    text_out_t out = { buf, buf ? size : 0, 0 };
+    if (unit_ratio <= 0) {
+        unit_ratio = 1;
+    }
+    const int digits = s->layout.digits;
+    text_printf(&out, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    // Percentile levels as in HdrHistogram's percentile iterator: the
+    // step halves every time the remaining distance to 100% halves
+    const double ticks_per_half_distance = 5;
+    double level = 0;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < s->layout.counts_len && seen < s->total; i++) {
+        if (s->counts[i] == 0) {
+            continue;
+        }
+        seen += s->counts[i];
+        while (level < 100.0 && 100.0 * (double) seen / (double) s->total >= level) {
+            text_line(&out, s, unit_ratio, i, level, seen);
+
+            double halvings = 0;
+            for (double d = 100.0 / (100.0 - level); d >= 2; d /= 2) {
+                halvings++;
+            }
+            double ticks = ticks_per_half_distance;
+            for (double k = 0; k < halvings + 1; k++) {
+                ticks *= 2;
+            }
+            level += 100.0 / ticks;
+            if (seen == s->total) {
+                break;
+            }
+        }
+        if (seen == s->total) {
+            text_line(&out, s, unit_ratio, i, 100.0, seen);
+        }
+    }
+
+    const double mean = histogram_mean(s);
+    double variance = 0;
+    for (size_t i = 0; i < s->layout.counts_len; i++) {
+        if (s->counts[i]) {
+            const double d = (double) layout_median_equivalent(&s->layout, i) - mean;
+            variance += d * d * (double) s->counts[i];
+        }
+    }
+    const double stddev = s->total ? histogram_sqrt(variance / (double) s->total) : 0;
+
+    text_printf(&out, "#[Mean    = %12.*f, StdDeviation   = %12.*f]\n",
+                digits, mean / unit_ratio, digits, stddev / unit_ratio);
+    text_printf(&out, "#[Max     = %12.*f, Total count    = %12llu]\n",
+                digits, (double) histogram_max(s) / unit_ratio, (unsigned long long) s->total);
+    text_printf(&out, "#[Buckets = %12u, SubBuckets     = %12u]\n",
+                s->layout.bucket_count, s->layout.sub_bucket_count);
+    return out.len;
+}
+
+// ============= INTERCHANGE ENCODING =============
+static uint8_t *put_be32(uint8_t *p, const uint32_t v) {
+    p[0] = (uint8_t) (v >> 24);
+    p[1] = (uint8_t) (v >> 16);
+    p[2] = (uint8_t) (v >> 8);
+    p[3] = (uint8_t) v;
+    return p + 4;
+}
+
+static uint8_t *put_be64(uint8_t *p, const uint64_t v) {
+    return put_be32(put_be32(p, (uint32_t) (v >> 32)), (uint32_t) v);
+}
+
+/**
+ * @brief ZigZag LEB128 as in HdrHistogram: up to eight 7-bit groups,
+ * then a ninth byte holding the last 8 bits.
+ */
+static uint8_t *put_zigzag(uint8_t *p, const int64_t value) {
+    uint64_t v = ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+    for (int i = 0; i < 8; i++) {
+        if ((v >> 7) == 0) {
+            *p++ = (uint8_t) v;
+            return p;
+        }
+        *p++ = (uint8_t) ((v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+/**
+ * @brief V2 encoding: header, then counts with runs of zeros written as
+ * negative run lengths. Returns the encoded length.
+ */
+static size_t encode_v2(const histogram_snapshot_t *s, uint8_t *out) {
+    size_t limit = 0;
+    for (size_t i = s->layout.counts_len; i > 0; i--) {
+        if (s->counts[i - 1]) {
+            limit = i;
+            break;
+        }
+    }
+
+    uint8_t *p = out + HISTOGRAM_HEADER_BYTES;
+    for (size_t i = 0; i < limit;) {
+        const uint64_t count = s->counts[i++];
+        if (count == 0) {
+            int64_t zeros = 1;
+            while (i < limit && s->counts[i] == 0) {
+                zeros++;
+                i++;
+            }
+            p = put_zigzag(p, zeros > 1 ? -zeros : 0);
+        } else {
+            p = put_zigzag(p, (int64_t) count);
+        }
+    }
+    const size_t payload = (size_t) (p - out) - HISTOGRAM_HEADER_BYTES;
+
+    uint64_t ratio_bits;
+    const double ratio = 1.0;
+    memcpy(&ratio_bits, &ratio, sizeof(ratio_bits));
+
+    uint8_t *h = put_be32(out, HISTOGRAM_ENCODING_COOKIE);
+    h = put_be32(h, (uint32_t) payload);
+    h = put_be32(h, 0);                              // normalizing index offset
+    h = put_be32(h, (uint32_t) s->layout.digits);
+    h = put_be64(h, 1);                              // lowest discernible value
+    h = put_be64(h, s->layout.highest);
+    put_be64(h, ratio_bits);                         // integer to double ratio
+    return HISTOGRAM_HEADER_BYTES + payload;
+}
+
+/**
+ * @brief Wraps `len` bytes in a zlib stream of stored deflate blocks.
+ * Returns the stream length.
+ */
+static size_t zlib_store(const uint8_t *in, const size_t len, uint8_t *out) {
+    uint8_t *p = out;
+    *p++ = 0x78; // deflate, 32 KiB window
+    *p++ = 0x01; // no preset dictionary, fastest; (0x7801 % 31 == 0)
+
+    size_t done = 0;
+    do {
+        const size_t n = len - done > 65535 ? 65535 : len - done;
+        *p++ = (uint8_t) (done + n == len); // BFINAL, BTYPE 00
+        *p++ = (uint8_t) n;
+        *p++ = (uint8_t) (n >> 8);
+        *p++ = (uint8_t) ~n;
+        *p++ = (uint8_t) (~n >> 8);
+        memcpy(p, in + done, n);
+        p += n;
+        done += n;
+    } while (done < len);
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < len; i++) {
+        a = (a + in[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    p = put_be32(p, (b << 16) | a);
+    return (size_t) (p - out);
+}
+
+size_t histogram_encode(const histogram_snapshot_t *s, char *buf, const size_t size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    const size_t raw_max = HISTOGRAM_HEADER_BYTES + s->layout.counts_len * 9;
+    const size_t zlib_max = 2 + (raw_max / 65535 + 1) * 5 + raw_max + 4;
+    uint8_t *raw = (uint8_t *) malloc(raw_max + 8 + zlib_max);
+    if (!raw) {
+        return 0;
+    }
+    uint8_t *wrapped = raw + raw_max;
+
+    const size_t raw_len = encode_v2(s, raw);
+    const size_t zlib_len = zlib_store(raw, raw_len, wrapped + 8);
+    put_be32(put_be32(wrapped, HISTOGRAM_COMPRESSED_COOKIE), (uint32_t) zlib_len);
+    const size_t bin_len = 8 + zlib_len;
+
+    const size_t out_len = (bin_len + 2) / 3 * 4;
+    if (buf && size > 0) {
+        size_t o = 0;
+        for (size_t i = 0; i < bin_len && o < size - 1; i += 3) {
+            const uint32_t triple = (uint32_t) wrapped[i] << 16
+                                    | (i + 1 < bin_len ? (uint32_t) wrapped[i + 1] << 8 : 0)
+                                    | (i + 2 < bin_len ? (uint32_t) wrapped[i + 2] : 0);
+            char quad[4];
+            quad[0] = alphabet[(triple >> 18) & 0x3F];
+            quad[1] = alphabet[(triple >> 12) & 0x3F];
+            quad[2] = i + 1 < bin_len ? alphabet[(triple >> 6) & 0x3F] : '=';
+            quad[3] = i + 2 < bin_len ? alphabet[triple & 0x3F] : '=';
+            for (int k = 0; k < 4 && o < size - 1; k++) {
+                buf[o++] = quad[k];
+            }
+        }
+        buf[o] = '\0';
+    }
+    free(raw);
+    return out_len;
+}
@@ -0,0 +1,235 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_HISTOGRAM_LIBRARY_H
+#define FLUENT_LIBC_HISTOGRAM_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// histogram_t API
+// ----------------------------------------
+// Log-linear latency histogram with the bucket layout of Gil Tene's
+// HdrHistogram. Values from 0 to a highest trackable value are counted
+// with a fixed number of significant decimal digits. Each power of two
+// is split into linear sub-buckets, so the relative error is bounded at
+// every magnitude.
+//
+// Recording is meant for hot paths. Each thread counts into its own
+// shard of the buckets with plain relaxed stores, so no cache line is
+// shared between writers. A shard is claimed on the thread's first
+// record and handed back when the thread exits, and another thread can
+// then reuse it. Readers take a snapshot, which merges every shard.
+// Under concurrent recording a snapshot may miss the newest samples.
+//
+// Snapshots can be queried for percentiles, printed as a percentile
+// distribution in HdrHistogram's text format, or encoded in the
+// HdrHistogram interchange format (compressed V2, base64), which the
+// HdrHistogram libraries, log processors and plotters decode.
+//
+// A shard holds one 64-bit counter per bucket: about 30 KiB for two
+// digits up to one minute in nanoseconds.
+// ----------------------------------------
+// Features:
+// - histogram_init:           Create an empty histogram.
+// - histogram_record:         Count one value.
+// - histogram_snapshot:       Merge every thread's counts.
+// - histogram_percentile:     Value at a percentile of a snapshot.
+// - histogram_mean:           Mean of a snapshot.
+// - histogram_max:            Largest value of a snapshot.
+// - histogram_format:         Percentile distribution as text.
+// - histogram_encode:         HdrHistogram interchange encoding.
+// - histogram_snapshot_free:  Release a snapshot.
+// - histogram_destroy:        Release a histogram.
+//
+// Function Signatures:
+// ----------------------------------------
+// int histogram_init(histogram_t *h, uint64_t highest, int digits);
+//     Example:
+//         histogram_t latency;
+//         histogram_init(&latency, 60000000000ULL, 2); // up to 60 s in ns
+//
+// void histogram_record(histogram_t *h, uint64_t value);
+//     Example:
+//         histogram_record(&latency, elapsed_ns);
+//
+// int histogram_snapshot(const histogram_t *h, histogram_snapshot_t *out);
+// uint64_t histogram_percentile(const histogram_snapshot_t *s, double percentile);
+// void histogram_snapshot_free(histogram_snapshot_t *s);
+//     Example:
+//         histogram_snapshot_t s;
+//         if (histogram_snapshot(&latency, &s) == 0) {
+//             printf("p99 %llu ns\n", (unsigned long long) histogram_percentile(&s, 99.0));
+//             histogram_snapshot_free(&s);
+//         }
+//
+// size_t histogram_format(const histogram_snapshot_t *s, double unit_ratio, char *buf, size_t size);
+//     Example:
+//         char text[16384];
+//         histogram_format(&s, 1000.0, text, sizeof(text)); // values in us
+//
+// size_t histogram_encode(const histogram_snapshot_t *s, char *buf, size_t size);
+//     Example:
+//         size_t len = histogram_encode(&s, NULL, 0);
+//         char *b64 = malloc(len + 1);
+//         histogram_encode(&s, b64, len + 1);
+//
+// void histogram_destroy(histogram_t *h);
+//     Example:
+//         histogram_destroy(&latency);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h, spinlock.h (implementation only)
+// ----------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Histograms a single thread records into at the same time
+ * without giving shards back.
+ */
+#ifndef HISTOGRAM_THREAD_CACHES
+#   define HISTOGRAM_THREAD_CACHES 16u
+#endif
+
+/**
+ * @brief Bucket layout shared by a histogram and its snapshots.
+ */
+typedef struct {
+    uint64_t highest;          /**< Highest trackable value; larger values are clamped to it */
+    int digits;                /**< Significant decimal digits, 1 to 5 */
+    uint32_t sub_bucket_count; /**< Linear sub-buckets per power of two */
+    uint32_t half_magnitude;   /**< log2(sub_bucket_count) - 1 */
+    uint32_t bucket_count;     /**< Powers of two covered */
+    size_t counts_len;         /**< Counters in the layout */
+} histogram_layout_t;
+
+struct histogram_shard;
+
+/**
+ * @brief Histogram with per-thread shards.
+ */
+typedef struct histogram {
+    histogram_layout_t layout;
+    uint64_t id;                    /**< Unique per histogram_init(); detects stale thread caches */
+    struct histogram_shard *shards; /**< Every shard, claimed or free (push-only) */
+    struct histogram *next_live;    /**< Link in the list of initialized histograms */
+} histogram_t;
+
+/**
+ * @brief Merged counts of a histogram at one point in time.
+ */
+typedef struct {
+    histogram_layout_t layout;
+    uint64_t *counts;   /**< layout.counts_len counters */
+    uint64_t total;     /**< Sum of counts */
+} histogram_snapshot_t;
+
+/**
+ * @brief Initializes an empty histogram.
+ *
+ * @param h Pointer to the histogram_t structure to initialize.
+ * @param highest Highest value to tell apart, at least 2.
+ * @param digits Significant decimal digits kept at every magnitude, 1 to 5.
+ * @return 0 on success, EINVAL for out-of-range arguments.
+ */
+int histogram_init(histogram_t *h, uint64_t highest, int digits);
+
+/**
+ * @brief Counts one value into the calling thread's shard.
+ *
+ * A value that cannot get a shard (out of memory) is dropped.
+ *
+ * @param h The histogram.
+ * @param value The value; clamped to the highest trackable value.
+ */
+void histogram_record(histogram_t *h, uint64_t value);
+
+/**
+ * @brief Merges every shard into a new snapshot.
+ *
+ * @param h The histogram.
+ * @param out Receives the snapshot; release it with histogram_snapshot_free().
+ * @return 0 on success, ENOMEM on allocation failure.
+ */
+int histogram_snapshot(const histogram_t *h, histogram_snapshot_t *out);
+
+/**
+ * @brief Releases the counts of a snapshot.
+ */
+void histogram_snapshot_free(histogram_snapshot_t *s);
+
+/**
+ * @brief Returns the value at or below which `percentile` percent of the
+ * samples fall (the highest value equivalent to it), or 0 when empty.
+ *
+ * @param s The snapshot.
+ * @param percentile Percentile, 0 to 100.
+ */
+uint64_t histogram_percentile(const histogram_snapshot_t *s, double percentile);
+
+/**
+ * @brief Returns the mean of the samples, or 0 when empty.
+ */
+double histogram_mean(const histogram_snapshot_t *s);
+
+/**
+ * @brief Returns the largest sample (the highest value equivalent to
+ * it), or 0 when empty.
+ */
+uint64_t histogram_max(const histogram_snapshot_t *s);
+
+/**
+ * @brief Writes the percentile distribution in the text format of
+ * HdrHistogram's outputPercentileDistribution(), five reporting ticks
+ * per half distance.
+ *
+ * @param s The snapshot.
+ * @param unit_ratio Divisor applied to printed values (e.g. 1000 for
+ * nanoseconds printed as microseconds).
+ * @param buf Destination, or NULL to measure.
+ * @param size Size of buf; output is truncated and NUL-terminated.
+ * @return Length of the full text, excluding the terminator, like snprintf.
+ */
+size_t histogram_format(const histogram_snapshot_t *s, double unit_ratio, char *buf, size_t size);
+
+/**
+ * @brief Writes the snapshot in the HdrHistogram interchange format:
+ * the V2 encoding wrapped in a compressed envelope, as base64.
+ *
+ * The deflate stream uses stored blocks, so no compression library is
+ * needed to produce it and any inflater reads it.
+ *
+ * @param s The snapshot.
+ * @param buf Destination, or NULL to measure.
+ * @param size Size of buf; output is truncated and NUL-terminated.
+ * @return Length of the full encoding, excluding the terminator, or 0
+ * on allocation failure.
+ */
+size_t histogram_encode(const histogram_snapshot_t *s, char *buf, size_t size);
+
+/**
+ * @brief Releases every shard. No thread may record meanwhile; stale
+ * thread caches are discarded on their next use.
+ */
+void histogram_destroy(histogram_t *h);
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_HISTOGRAM_LIBRARY_H
@@ -0,0 +1,183 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_LATCH_LIBRARY_H
+#define FLUENT_LIBC_LATCH_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// latch_t API
+// ----------------------------------------
+// One-shot countdown latch: threads wait until the counter reaches zero.
+// Counting down is a single atomic instruction; only the final count
+// down wakes sleepers, with one futex-style wake of the whole set.
+// ----------------------------------------
+// Features:
+// - latch_init:             Initialize a latch with an expected count.
+// - latch_count_down:       Decrement the counter by n.
+// - latch_try_wait:         Check whether the counter reached zero.
+// - latch_wait:             Block until the counter reaches zero.
+// - latch_wait_timed:       Block with a timeout.
+// - latch_arrive_and_wait:  Count down by n, then wait.
+//
+// Function Signatures:
+// ----------------------------------------
+// void latch_init(latch_t *l, uint32_t count);
+//     Example:
+//         latch_t l;
+//         latch_init(&l, 4);
+//
+// void latch_count_down(latch_t *l, uint32_t n);
+//     Example:
+//         latch_count_down(&l, 1);
+//
+// int latch_try_wait(latch_t *l);
+//     Example:
+//         if (latch_try_wait(&l)) { ... }
+//
+// void latch_wait(latch_t *l);
+//     Example:
+//         latch_wait(&l);
+//
+// int latch_wait_timed(latch_t *l, uint64_t timeout_ns);
+//     Example:
+//         if (latch_wait_timed(&l, 1000000) == ETIMEDOUT) { ... }
+//
+// void latch_arrive_and_wait(latch_t *l, uint32_t n);
+//     Example:
+//         latch_arrive_and_wait(&l, 1);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: wait.h
+// ----------------------------------------
+
+#include <errno.h>
+#include "parking_lot.h"
+#include "wait.h"
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Pause-spins a waiter does before sleeping.
+ */
+#ifndef LATCH_SPIN_LIMIT
+#   define LATCH_SPIN_LIMIT 100
+#endif
+
+/**
+ * @brief One-shot countdown latch.
+ */
+typedef struct {
+    uint32_t count;     /**< Remaining count downs */
+    uint32_t sleepers;  /**< Non-zero once a waiter may be asleep */
+} latch_t;
+
+/**
+ * @brief Initializes the latch.
+ *
+ * @param l Pointer to the latch_t structure to initialize.
+ * @param count Number of count downs that open the latch.
+ */
+static inline void latch_init(latch_t *l, const uint32_t count) {
+    l->count = count;
+    l->sleepers = 0;
+}
+
+/**
+ * @brief Decrements the counter, opening the latch when it reaches zero.
+ *
+ * @param l Pointer to the latch_t structure.
+ * @param n Amount to count down; must not exceed the remaining count.
+ */
+static inline void latch_count_down(latch_t *l, const uint32_t n) {
+    // seq_cst pairs with the waiters' sleepers store (Dekker style)
+    if (__atomic_sub_fetch(&l->count, n, __ATOMIC_SEQ_CST) == 0
+        && __atomic_load_n(&l->sleepers, __ATOMIC_SEQ_CST) != 0) {
+        wake_all(&l->count);
+    }
+}
+
+/**
+ * @brief Checks whether the latch is open.
+ *
+ * @param l Pointer to the latch_t structure.
+ * @return 1 if the counter reached zero, 0 otherwise.
+ */
+static inline int latch_try_wait(latch_t *l) {
+    return __atomic_load_n(&l->count, __ATOMIC_ACQUIRE) == 0;
+}
+
+/**
+ * @brief Blocks until the latch opens or the timeout elapses.
+ *
+ * @param l Pointer to the latch_t structure.
+ * @param timeout_ns Relative timeout, or PARKING_LOT_FOREVER.
+ * @return 0 once the latch is open, ETIMEDOUT on timeout.
+ */
+static inline int latch_wait_timed(latch_t *l, const uint64_t timeout_ns) {
+    for (int i = 0; i < LATCH_SPIN_LIMIT; i++) {
+        if (latch_try_wait(l)) {
+            return 0;
+        }
+        mutex_cpu_relax();
+    }
+
+    const uint64_t start = timeout_ns == PARKING_LOT_FOREVER ? 0 : parking_lot_now_ns();
+    __atomic_store_n(&l->sleepers, 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+        const uint32_t count = __atomic_load_n(&l->count, __ATOMIC_SEQ_CST);
+        if (count == 0) {
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            return 0;
+        }
+
+        uint64_t remaining = PARKING_LOT_FOREVER;
+        if (timeout_ns != PARKING_LOT_FOREVER) {
+            const uint64_t elapsed = parking_lot_now_ns() - start;
+            if (elapsed >= timeout_ns) {
+                return ETIMEDOUT;
+            }
+            remaining = timeout_ns - elapsed;
+        }
+        wait_on_address(&l->count, count, remaining);
+    }
+}
+
+/**
+ * @brief Blocks until the latch opens.
+ *
+ * @param l Pointer to the latch_t structure.
+ */
+static inline void latch_wait(latch_t *l) {
+    latch_wait_timed(l, PARKING_LOT_FOREVER);
+}
+
+/**
+ * @brief Counts down by n, then waits for the latch to open.
+ *
+ * @param l Pointer to the latch_t structure.
+ * @param n Amount to count down.
+ */
+static inline void latch_arrive_and_wait(latch_t *l, const uint32_t n) {
+    latch_count_down(l, n);
+    latch_wait(l);
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_LATCH_LIBRARY_H
@@ -0,0 +1,456 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_MPMC_QUEUE_LIBRARY_H
+#define FLUENT_LIBC_MPMC_QUEUE_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// mpmc_queue_t API
+// ----------------------------------------
+// Bounded, lock-free multi-producer/multi-consumer queue of pointers
+// (Dmitry Vyukov's sequence-cell ring). Each cell carries a sequence
+// number that tells producers and consumers whether it is free or full
+// for the current lap, so an operation is one compare-and-swap on the
+// head or tail index plus one store to the cell. Head and tail live on
+// separate cache lines, so producers and consumers do not contend with
+// each other.
+//
+// The batch calls claim a run of cells with a single compare-and-swap.
+// The blocking calls spin briefly, then sleep on a per-side word through
+// wait_on_address; producers and consumers only issue a wake-up when the
+// other side has sleepers.
+// ----------------------------------------
+// Features:
+// - mpmc_queue_init:                Allocate a queue with a capacity.
+// - mpmc_queue_try_enqueue:         Push one item if there is room.
+// - mpmc_queue_try_dequeue:         Pop one item if there is one.
+// - mpmc_queue_try_enqueue_batch:   Push up to n items at once.
+// - mpmc_queue_try_dequeue_batch:   Pop up to n items at once.
+// - mpmc_queue_enqueue:             Push, sleeping while the queue is full.
+// - mpmc_queue_dequeue:             Pop, sleeping while the queue is empty.
+// - mpmc_queue_enqueue_timed:       Push with a timeout.
+// - mpmc_queue_dequeue_timed:       Pop with a timeout.
+// - mpmc_queue_size:                Approximate number of queued items.
+// - mpmc_queue_destroy:             Release queue memory.
+//
+// Function Signatures:
+// ----------------------------------------
+// int mpmc_queue_init(mpmc_queue_t *q, size_t capacity);
+//     Example:
+//         mpmc_queue_t jobs;
+//         mpmc_queue_init(&jobs, 1024);
+//
+// int mpmc_queue_try_enqueue(mpmc_queue_t *q, void *item);
+//     Example:
+//         if (!mpmc_queue_try_enqueue(&jobs, job)) { ... full ... }
+//
+// int mpmc_queue_try_dequeue(mpmc_queue_t *q, void **item);
+//     Example:
+//         void *job;
+//         if (mpmc_queue_try_dequeue(&jobs, &job)) { run(job); }
+//
+// size_t mpmc_queue_try_enqueue_batch(mpmc_queue_t *q, void *const *items, size_t n);
+//     Example:
+//         size_t pushed = mpmc_queue_try_enqueue_batch(&jobs, batch, 16);
+//
+// size_t mpmc_queue_try_dequeue_batch(mpmc_queue_t *q, void **items, size_t n);
+//     Example:
+//         void *batch[16];
+//         size_t popped = mpmc_queue_try_dequeue_batch(&jobs, batch, 16);
+//
+// void mpmc_queue_enqueue(mpmc_queue_t *q, void *item);
+//     Example:
+//         mpmc_queue_enqueue(&jobs, job);
+//
+// void *mpmc_queue_dequeue(mpmc_queue_t *q);
+//     Example:
+//         run(mpmc_queue_dequeue(&jobs));
+//
+// int mpmc_queue_enqueue_timed(mpmc_queue_t *q, void *item, uint64_t timeout_ns);
+//     Example:
+//         if (mpmc_queue_enqueue_timed(&jobs, job, 1000000) == ETIMEDOUT) { ... }
+//
+// int mpmc_queue_dequeue_timed(mpmc_queue_t *q, void **item, uint64_t timeout_ns);
+//     Example:
+//         if (mpmc_queue_dequeue_timed(&jobs, &job, 1000000) == 0) { run(job); }
+//
+// size_t mpmc_queue_size(const mpmc_queue_t *q);
+//     Example:
+//         printf("%zu pending\n", mpmc_queue_size(&jobs));
+//
+// void mpmc_queue_destroy(mpmc_queue_t *q);
+//     Example:
+//         mpmc_queue_destroy(&jobs);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: wait.h
+// ----------------------------------------
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "parking_lot.h"
+#include "wait.h"
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Failed attempts a blocking call spins through before sleeping.
+ */
+#ifndef MPMC_QUEUE_SPIN_LIMIT
+#   define MPMC_QUEUE_SPIN_LIMIT 100
+#endif
+
+/**
+ * @brief Ring slot: the item plus the lap sequence that guards it.
+ */
+typedef struct {
+    size_t seq;  /**< pos: free for the producer of pos; pos + 1: full for its consumer */
+    void *data;  /**< The queued item */
+} mpmc_queue_cell_t;
+
+/**
+ * @brief Ring index on its own cache line.
+ */
+typedef union {
+    size_t pos;
+    char pad[64];
+} mpmc_queue_index_t;
+
+/**
+ * @brief Sleep word for one side of the queue, on its own cache line.
+ */
+typedef union {
+    struct {
+        uint32_t seq;       /**< Bumped by the other side before a wake-up */
+        uint32_t sleepers;  /**< Threads that may be asleep on `seq` */
+    } w;
+    char pad[64];
+} mpmc_queue_waiters_t;
+
+/**
+ * @brief Bounded lock-free MPMC queue.
+ */
+typedef struct {
+    mpmc_queue_index_t head;        /**< Next position to enqueue */
+    mpmc_queue_index_t tail;        /**< Next position to dequeue */
+    mpmc_queue_waiters_t not_empty; /**< Consumers waiting for items */
+    mpmc_queue_waiters_t not_full;  /**< Producers waiting for room */
+    mpmc_queue_cell_t *cells;       /**< capacity cells */
+    size_t mask;                    /**< capacity - 1 */
+} mpmc_queue_t;
+
+/**
+ * @brief Initializes the queue.
+ *
+ * @param q Pointer to the mpmc_queue_t structure to initialize.
+ * @param capacity Minimum number of items; rounded up to a power of two.
+ * @return 0 on success, EINVAL for a zero capacity, ENOMEM on allocation failure.
+ */
+static inline int mpmc_queue_init(mpmc_queue_t *q, const size_t capacity) {
+    if (capacity == 0 || capacity > ((size_t) -1 >> 1)) {
+        return EINVAL;
+    }
+
+    size_t cap = 1;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    q->cells = (mpmc_queue_cell_t *) malloc(cap * sizeof(mpmc_queue_cell_t));
+    if (!q->cells) {
+        return ENOMEM;
+    }
+    for (size_t i = 0; i < cap; i++) {
+        q->cells[i].seq = i;
+        q->cells[i].data = NULL;
+    }
+
+    q->mask = cap - 1;
+    q->head.pos = 0;
+    q->tail.pos = 0;
+    q->not_empty.w.seq = 0;
+    q->not_empty.w.sleepers = 0;
+    q->not_full.w.seq = 0;
+    q->not_full.w.sleepers = 0;
+    return 0;
+}
+
+/**
+ * @brief Wakes up to n sleepers of one side after the other side made progress.
+ */
+static inline void mpmc_queue_notify(mpmc_queue_waiters_t *w, const size_t n) {
+    // Pairs with the sleeper's seq_cst sleepers increment (Dekker style)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->w.sleepers, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+    __atomic_add_fetch(&w->w.seq, 1, __ATOMIC_SEQ_CST);
+    wake_n(&w->w.seq, n > UINT32_MAX ? WAIT_ALL : (uint32_t) n);
+}
+
+/**
+ * @brief Claims up to n consecutive cells whose sequence is `pos + i + offset`.
+ *
+ * Producers pass offset 0 (free cells), consumers offset 1 (full cells).
+ *
+ * @return The first claimed position; *claimed receives the run length (0 if none).
+ */
+static inline size_t mpmc_queue_claim(mpmc_queue_t *q, mpmc_queue_index_t *index,
+                                      const size_t offset, const size_t n, size_t *claimed) {
+    size_t pos = __atomic_load_n(&index->pos, __ATOMIC_RELAXED);
+    for (;;) {
+        size_t ready = 0;
+        while (ready < n) {
+            const size_t seq = __atomic_load_n(&q->cells[(pos + ready) & q->mask].seq, __ATOMIC_ACQUIRE);
+            if (seq != pos + ready + offset) {
+                break;
+            }
+            ready++;
+        }
+
+        if (ready == 0) {
+            // A lagging sequence means the ring is full/empty; an advanced
+            // one means another thread claimed pos and we must reload
+            const size_t seq = __atomic_load_n(&q->cells[pos & q->mask].seq, __ATOMIC_ACQUIRE);
+            if ((ptrdiff_t) (seq - (pos + offset)) < 0) {
+                *claimed = 0;
+                return pos;
+            }
+            pos = __atomic_load_n(&index->pos, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        // Nobody else can claim positions past pos once this succeeds,
+        // so the cells checked above stay ready for us
+        if (__atomic_compare_exchange_n(&index->pos, &pos, pos + ready, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            *claimed = ready;
+            return pos;
+        }
+    }
+}
+
+/**
+ * @brief Pushes up to n items, stopping when the queue is full.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param items Items to push, in order.
+ * @param n Number of items.
+ * @return Number of items pushed, from the front of `items`.
+ */
+static inline size_t mpmc_queue_try_enqueue_batch(mpmc_queue_t *q, void *const *items, const size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        size_t claimed;
+        const size_t pos = mpmc_queue_claim(q, &q->head, 0, n - done, &claimed);
+        if (claimed == 0) {
+            break;
+        }
+        for (size_t i = 0; i < claimed; i++) {
+            mpmc_queue_cell_t *cell = &q->cells[(pos + i) & q->mask];
+            cell->data = items[done + i];
+            __atomic_store_n(&cell->seq, pos + i + 1, __ATOMIC_RELEASE);
+        }
+        done += claimed;
+    }
+
+    if (done) {
+        mpmc_queue_notify(&q->not_empty, done);
+    }
+    return done;
+}
+
+/**
+ * @brief Pops up to n items, stopping when the queue is empty.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param items Receives the popped items, in queue order.
+ * @param n Capacity of `items`.
+ * @return Number of items popped.
+ */
+static inline size_t mpmc_queue_try_dequeue_batch(mpmc_queue_t *q, void **items, const size_t n) {
+    size_t done = 0;
+    while (done < n) {
+        size_t claimed;
+        const size_t pos = mpmc_queue_claim(q, &q->tail, 1, n - done, &claimed);
+        if (claimed == 0) {
+            break;
+        }
+        for (size_t i = 0; i < claimed; i++) {
+            mpmc_queue_cell_t *cell = &q->cells[(pos + i) & q->mask];
+            items[done + i] = cell->data;
+            // Free the cell for the producer one lap ahead
+            __atomic_store_n(&cell->seq, pos + i + q->mask + 1, __ATOMIC_RELEASE);
+        }
+        done += claimed;
+    }
+
+    if (done) {
+        mpmc_queue_notify(&q->not_full, done);
+    }
+    return done;
+}
+
+/**
+ * @brief Pushes one item if there is room.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param item Item to push.
+ * @return 1 if the item was pushed, 0 if the queue is full.
+ */
+static inline int mpmc_queue_try_enqueue(mpmc_queue_t *q, void *item) {
+    return mpmc_queue_try_enqueue_batch(q, &item, 1) == 1;
+}
+
+/**
+ * @brief Pops one item if there is one.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param item Receives the popped item.
+ * @return 1 if an item was popped, 0 if the queue is empty.
+ */
+static inline int mpmc_queue_try_dequeue(mpmc_queue_t *q, void **item) {
+    return mpmc_queue_try_dequeue_batch(q, item, 1) == 1;
+}
+
+/**
+ * @brief Retries a push or pop, sleeping on `w` between attempts.
+ *
+ * @return 0 on success, ETIMEDOUT on timeout.
+ */
+static inline int mpmc_queue_block(mpmc_queue_t *q, mpmc_queue_waiters_t *w,
+                                   int (*attempt)(mpmc_queue_t *, void **), void **item,
+                                   const uint64_t timeout_ns) {
+    for (int i = 0; i < MPMC_QUEUE_SPIN_LIMIT; i++) {
+        if (attempt(q, item)) {
+            return 0;
+        }
+        mutex_cpu_relax();
+    }
+
+    const uint64_t start = timeout_ns == PARKING_LOT_FOREVER ? 0 : parking_lot_now_ns();
+    int result = 0;
+
+    __atomic_add_fetch(&w->w.sleepers, 1, __ATOMIC_SEQ_CST);
+    for (;;) {
+        // Sample the word before re-checking so a notify in between is seen
+        const uint32_t seq = __atomic_load_n(&w->w.seq, __ATOMIC_SEQ_CST);
+        if (attempt(q, item)) {
+            break;
+        }
+
+        uint64_t remaining = PARKING_LOT_FOREVER;
+        if (timeout_ns != PARKING_LOT_FOREVER) {
+            const uint64_t elapsed = parking_lot_now_ns() - start;
+            if (elapsed >= timeout_ns) {
+                result = ETIMEDOUT;
+                break;
+            }
+            remaining = timeout_ns - elapsed;
+        }
+        wait_on_address(&w->w.seq, seq, remaining);
+    }
+    __atomic_sub_fetch(&w->w.sleepers, 1, __ATOMIC_RELAXED);
+    return result;
+}
+
+static inline int mpmc_queue_attempt_enqueue(mpmc_queue_t *q, void **item) {
+    return mpmc_queue_try_enqueue(q, *item);
+}
+
+/**
+ * @brief Pushes one item, sleeping until there is room or the timeout elapses.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param item Item to push.
+ * @param timeout_ns Relative timeout, or PARKING_LOT_FOREVER.
+ * @return 0 on success, ETIMEDOUT if the queue stayed full.
+ */
+static inline int mpmc_queue_enqueue_timed(mpmc_queue_t *q, void *item, const uint64_t timeout_ns) {
+    if (mpmc_queue_try_enqueue(q, item)) {
+        return 0;
+    }
+    return mpmc_queue_block(q, &q->not_full, mpmc_queue_attempt_enqueue, &item, timeout_ns);
+}
+
+/**
+ * @brief Pops one item, sleeping until there is one or the timeout elapses.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param item Receives the popped item.
+ * @param timeout_ns Relative timeout, or PARKING_LOT_FOREVER.
+ * @return 0 on success, ETIMEDOUT if the queue stayed empty.
+ */
+static inline int mpmc_queue_dequeue_timed(mpmc_queue_t *q, void **item, const uint64_t timeout_ns) {
+    if (mpmc_queue_try_dequeue(q, item)) {
+        return 0;
+    }
+    return mpmc_queue_block(q, &q->not_empty, mpmc_queue_try_dequeue, item, timeout_ns);
+}
+
+/**
+ * @brief Pushes one item, sleeping while the queue is full.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @param item Item to push.
+ */
+static inline void mpmc_queue_enqueue(mpmc_queue_t *q, void *item) {
+    mpmc_queue_enqueue_timed(q, item, PARKING_LOT_FOREVER);
+}
+
+/**
+ * @brief Pops one item, sleeping while the queue is empty.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @return The popped item.
+ */
+static inline void *mpmc_queue_dequeue(mpmc_queue_t *q) {
+    void *item = NULL;
+    mpmc_queue_dequeue_timed(q, &item, PARKING_LOT_FOREVER);
+    return item;
+}
+
+/**
+ * @brief Returns the approximate number of queued items.
+ *
+ * Exact only while no other thread uses the queue.
+ *
+ * @param q Pointer to the mpmc_queue_t structure.
+ * @return Items claimed by producers but not yet by consumers.
+ */
+static inline size_t mpmc_queue_size(const mpmc_queue_t *q) {
+    const size_t tail = __atomic_load_n(&q->tail.pos, __ATOMIC_RELAXED);
+    const size_t head = __atomic_load_n(&q->head.pos, __ATOMIC_RELAXED);
+    return (ptrdiff_t) (head - tail) > 0 ? head - tail : 0;
+}
+
+/**
+ * @brief Destroys the queue. Items still queued are not freed.
+ *
+ * @param q Pointer to the mpmc_queue_t structure to destroy.
+ */
+static inline void mpmc_queue_destroy(mpmc_queue_t *q) {
+    free(q->cells);
+    q->cells = NULL;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_MPMC_QUEUE_LIBRARY_H
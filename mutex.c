@@ -8,4 +8,1759 @@
  * under certain conditions; type show c' for details.
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#   define _GNU_SOURCE // sched_getcpu
+#endif
+
 #include "mutex.h"
+#include "cycleclock.h"
+#include "parking_lot.h"
+#include "spinlock.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#   include <sys/mman.h>
+#endif
+#if defined(__GLIBC__)
+#   include <execinfo.h>
+#endif
+
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#   if __GLIBC_PREREQ(2, 35) && (defined(__x86_64__) || defined(__aarch64__))
+#       include <sys/rseq.h>
+#       define MUTEX_HAVE_RSEQ 1
+#   endif
+#endif
+
+/**
+ * @brief Number of yielding spins before a contended locker parks.
+ */
+#ifndef MUTEX_SPIN_LIMIT
+#   define MUTEX_SPIN_LIMIT 40
+#endif
+
+/**
+ * @brief Pause-spins a MUTEX_SPIN_OWNER_RUNNING waiter may do before
+ * parking even though the owner still looks busy.
+ */
+#ifndef MUTEX_OWNER_SPIN_LIMIT
+#   define MUTEX_OWNER_SPIN_LIMIT 20000
+#endif
+
+/**
+ * @brief CPUs tracked by the per-CPU spinner table.
+ */
+#ifndef MUTEX_MAX_CPUS
+#   define MUTEX_MAX_CPUS 1024
+#endif
+
+/**
+ * @brief Distinct stacks the contention profiler keeps; samples with
+ * further stacks are dropped.
+ */
+#ifndef MUTEX_PROFILE_BUCKETS
+#   define MUTEX_PROFILE_BUCKETS 1024
+#endif
+
+/**
+ * @brief Token telling a woken waiter that it now owns the lock.
+ */
+#define MUTEX_TOKEN_HANDOFF ((uintptr_t) 1)
+
+// ============= THREAD RUNNING STATE =============
+/**
+ * @brief What a thread publishes about itself for owner-aware spinning.
+ *
+ * Records are never freed, only recycled when their thread exits, so a
+ * spinner may always dereference mutex_t::owner_state; it checks `tid`
+ * against the mutex owner to detect a recycled record.
+ */
+struct mutex_thread_state {
+    mutex_thread_state_t *next_free;
+    uintptr_t tid;      // Current thread, 0 while on the free list
+    uint32_t running;   // 0 while the thread is blocked
+};
+
+static spinlock_t thread_state_guard = SPINLOCK_INIT;
+static mutex_thread_state_t *thread_state_free = NULL;
+static FLUENT_LIBC_THREAD_LOCAL mutex_thread_state_t *thread_state = NULL;
+
+// Number of spinners currently running on each CPU, one counter per
+// cache line so that spinners on different CPUs do not contend
+typedef union {
+    uint32_t count;
+    char pad[64];
+} cpu_spinners_t;
+
+static cpu_spinners_t cpu_spinners[MUTEX_MAX_CPUS];
+
+#ifndef _WIN32
+static pthread_key_t thread_state_key;
+static pthread_once_t thread_state_once = PTHREAD_ONCE_INIT;
+
+static void thread_state_release(void *arg) {
+    mutex_thread_state_t *state = (mutex_thread_state_t *) arg;
+    __atomic_store_n(&state->running, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&state->tid, 0, __ATOMIC_RELAXED);
+
+    spinlock_lock(&thread_state_guard);
+    state->next_free = thread_state_free;
+    thread_state_free = state;
+    spinlock_unlock(&thread_state_guard);
+}
+
+static void thread_state_key_create(void) {
+    pthread_key_create(&thread_state_key, thread_state_release);
+}
+#endif
+
+static mutex_thread_state_t *thread_state_get(void) {
+    mutex_thread_state_t *state = thread_state;
+    if (state) {
+        return state;
+    }
+
+    spinlock_lock(&thread_state_guard);
+    state = thread_state_free;
+    if (state) {
+        thread_state_free = state->next_free;
+    }
+    spinlock_unlock(&thread_state_guard);
+
+    if (!state) {
+        state = (mutex_thread_state_t *) calloc(1, sizeof(mutex_thread_state_t));
+        if (!state) {
+            return NULL;
+        }
+    }
+
+    state->next_free = NULL;
+    __atomic_store_n(&state->running, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&state->tid, mutex_thread_id(), __ATOMIC_RELAXED);
+
+#ifndef _WIN32
+    // Recycle the record at thread exit (Windows threads keep theirs)
+    pthread_once(&thread_state_once, thread_state_key_create);
+    pthread_setspecific(thread_state_key, state);
+#endif
+    thread_state = state;
+    return state;
+}
+
+int mutex_current_cpu(void) {
+#if defined(MUTEX_HAVE_RSEQ)
+    if (__rseq_size > 0) {
+        const struct rseq *rs = (const struct rseq *) ((char *) __builtin_thread_pointer() + __rseq_offset);
+        const int32_t cpu = (int32_t) __atomic_load_n(&rs->cpu_id, __ATOMIC_RELAXED);
+        if (cpu >= 0) {
+            return cpu;
+        }
+    }
+    return sched_getcpu();
+#elif defined(__linux__)
+    return sched_getcpu();
+#elif defined(_WIN32) && !defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+    return (int) GetCurrentProcessorNumber();
+#else
+    return -1;
+#endif
+}
+
+void mutex_publish_owner(mutex_t *m) {
+    __atomic_store_n(&m->owner_state, thread_state_get(), __ATOMIC_RELAXED);
+    __atomic_store_n(&m->owner_cpu, mutex_current_cpu(), __ATOMIC_RELAXED);
+}
+
+void mutex_thread_blocking_begin(void) {
+    // Threads without a record have never owned an owner-aware mutex
+    if (thread_state) {
+        __atomic_store_n(&thread_state->running, 0, __ATOMIC_RELAXED);
+    }
+}
+
+void mutex_thread_blocking_end(void) {
+    if (thread_state) {
+        __atomic_store_n(&thread_state->running, 1, __ATOMIC_RELAXED);
+    }
+}
+
+// ============= LOCK / UNLOCK SLOW PATHS =============
+
+/**
+ * @brief Claims one of the mutex's spinner slots.
+ *
+ * @return 1 if the caller may spin, 0 if it should park right away.
+ */
+static int mutex_spinner_enter(mutex_t *m) {
+    if (m->max_spinners == 0) {
+        return 1;
+    }
+
+    uint32_t spinners = __atomic_load_n(&m->spinners, __ATOMIC_RELAXED);
+    while (spinners < m->max_spinners) {
+        if (__atomic_compare_exchange_n(&m->spinners, &spinners, spinners + 1, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void mutex_spinner_exit(mutex_t *m) {
+    if (m->max_spinners != 0) {
+        __atomic_fetch_sub(&m->spinners, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Tells whether spinning can still pay off.
+ *
+ * Only mutexes with owner hints record the owner's CPU and state. The
+ * owner is known not to be running when its record says it is blocked,
+ * when we run on its CPU, or when another spinner does. While the owner
+ * is being replaced (stale record) it is given the benefit of the doubt.
+ */
+static int mutex_owner_may_run(const mutex_t *m, const int my_cpu) {
+    if (!m->owner_hints) {
+        return 1;
+    }
+
+    const uintptr_t owner = __atomic_load_n(&m->owner, __ATOMIC_RELAXED);
+    const mutex_thread_state_t *state = __atomic_load_n(&m->owner_state, __ATOMIC_RELAXED);
+    if (owner == 0 || !state || __atomic_load_n(&state->tid, __ATOMIC_RELAXED) != owner) {
+        return 1;
+    }
+
+    if (!__atomic_load_n(&state->running, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    const int owner_cpu = __atomic_load_n(&m->owner_cpu, __ATOMIC_RELAXED);
+    if (owner_cpu < 0) {
+        return 1;
+    }
+    if (owner_cpu == my_cpu) {
+        return 0;
+    }
+    return owner_cpu >= MUTEX_MAX_CPUS
+        || __atomic_load_n(&cpu_spinners[owner_cpu].count, __ATOMIC_RELAXED) == 0;
+}
+
+/**
+ * @brief Spins while the owner appears to be running (MUTEX_SPIN_OWNER_RUNNING).
+ *
+ * @return 1 if the lock word showed the mutex unlocked, 0 if the caller
+ *         should stop spinning.
+ */
+static int mutex_spin_on_owner(const mutex_t *m) {
+    int cpu = mutex_current_cpu();
+    int slot = cpu >= 0 && cpu < MUTEX_MAX_CPUS ? cpu : -1;
+    int freed = 0;
+
+    if (slot >= 0) {
+        __atomic_fetch_add(&cpu_spinners[slot].count, 1, __ATOMIC_RELAXED);
+    }
+
+    for (unsigned int spins = 0; spins < MUTEX_OWNER_SPIN_LIMIT; spins++) {
+        const uint32_t state = __atomic_load_n(&m->state, __ATOMIC_RELAXED);
+        if (!(state & MUTEX_STATE_LOCKED)) {
+            freed = 1;
+            break;
+        }
+        if ((state & MUTEX_STATE_PARKED) || !mutex_owner_may_run(m, cpu)) {
+            break;
+        }
+
+        mutex_cpu_relax();
+        if ((spins & 63) == 63) {
+            cpu = mutex_current_cpu(); // We may have migrated
+            const int now = cpu >= 0 && cpu < MUTEX_MAX_CPUS ? cpu : -1;
+            if (now != slot) {
+                // Count ourselves on the CPU we actually spin on
+                if (slot >= 0) {
+                    __atomic_fetch_sub(&cpu_spinners[slot].count, 1, __ATOMIC_RELAXED);
+                }
+                if (now >= 0) {
+                    __atomic_fetch_add(&cpu_spinners[now].count, 1, __ATOMIC_RELAXED);
+                }
+                slot = now;
+            }
+        }
+    }
+
+    if (slot >= 0) {
+        __atomic_fetch_sub(&cpu_spinners[slot].count, 1, __ATOMIC_RELAXED);
+    }
+    return freed;
+}
+
+static int mutex_should_park(void *ctx) {
+    const mutex_t *m = (const mutex_t *) ctx;
+    return __atomic_load_n(&m->state, __ATOMIC_RELAXED) == (MUTEX_STATE_LOCKED | MUTEX_STATE_PARKED);
+}
+
+/**
+ * @brief Acquires a mutex whose fast path failed.
+ */
+static void mutex_lock_contended(mutex_t *m) {
+    unsigned int spins = 0;
+    int spinning = mutex_spinner_enter(m);
+    // Only owner hints compare CPUs; we can only migrate while yielding
+    int cpu = m->owner_hints ? mutex_current_cpu() : -1;
+
+    for (;;) {
+        uint32_t state = __atomic_load_n(&m->state, __ATOMIC_RELAXED);
+
+        if (!(state & MUTEX_STATE_LOCKED)) {
+            // Barge in; PARKED is preserved for the waiters still queued
+            if (__atomic_compare_exchange_n(&m->state, &state, state | MUTEX_STATE_LOCKED, 1,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                if (spinning) {
+                    mutex_spinner_exit(m);
+                }
+                return;
+            }
+            continue;
+        }
+
+        // Spin only while nobody is parked: queued threads mean the hold
+        // times are long enough that spinning would just burn the CPU
+        if (spinning) {
+            if (m->spin == MUTEX_SPIN_OWNER_RUNNING) {
+                if (!(state & MUTEX_STATE_PARKED) && spins++ == 0 && mutex_spin_on_owner(m)) {
+                    spins = 0; // Lost the race for a freed lock; spin again
+                    continue;
+                }
+            } else if (!(state & MUTEX_STATE_PARKED) && spins < MUTEX_SPIN_LIMIT
+                       && mutex_owner_may_run(m, cpu)) {
+                spins++;
+                mutex_thread_yield();
+                if (m->owner_hints) {
+                    cpu = mutex_current_cpu();
+                }
+                continue;
+            }
+
+            // Done spinning for this acquisition; free the slot for others
+            mutex_spinner_exit(m);
+            spinning = 0;
+        }
+
+        if (!(state & MUTEX_STATE_PARKED)) {
+            if (!__atomic_compare_exchange_n(&m->state, &state, state | MUTEX_STATE_PARKED, 1,
+                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                continue;
+            }
+        }
+
+        uintptr_t token = 0;
+        const parking_lot_result_t result = parking_lot_park(
+            &m->state, mutex_should_park, NULL, m, PARKING_LOT_FOREVER, &token
+        );
+        if (result == PARKING_LOT_UNPARKED && token == MUTEX_TOKEN_HANDOFF) {
+            // The unlocker kept the lock held and passed it to us
+            return;
+        }
+    }
+}
+
+static uintptr_t mutex_unlock_callback(void *ctx, const parking_lot_unpark_result_t result) {
+    mutex_t *m = (mutex_t *) ctx;
+    int handoff = 0;
+
+    if (result.unparked_thread) {
+        switch (m->handoff) {
+            case MUTEX_HANDOFF_FIFO:
+                handoff = 1;
+                break;
+            case MUTEX_HANDOFF_EVENTUAL:
+                handoff = result.wait_ns >= m->fair_threshold_ns;
+                break;
+            case MUTEX_HANDOFF_BARGING:
+                break;
+        }
+    }
+
+    // Runs under the queue lock, so parkers cannot slip in between
+    // the dequeue and this store
+    const uint32_t parked = result.may_have_more ? MUTEX_STATE_PARKED : 0;
+    if (handoff) {
+        __atomic_store_n(&m->state, MUTEX_STATE_LOCKED | parked, __ATOMIC_RELAXED);
+        return MUTEX_TOKEN_HANDOFF;
+    }
+
+    __atomic_store_n(&m->state, parked, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void mutex_unlock_slow(mutex_t *m) {
+    for (;;) {
+        uint32_t state = __atomic_load_n(&m->state, __ATOMIC_RELAXED);
+
+        if (state == MUTEX_STATE_LOCKED) {
+            // The last waiter left between the fast path and here
+            if (__atomic_compare_exchange_n(&m->state, &state, 0, 1,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                return;
+            }
+            continue;
+        }
+
+        parking_lot_unpark_one(&m->state, mutex_unlock_callback, m);
+        return;
+    }
+}
+
+// ============= CONTENTION PROFILER =============
+/**
+ * @brief Contention attributed to one call stack, already scaled by the
+ * sampling rate in effect when each sample was taken.
+ */
+typedef struct {
+    uint64_t hash;      // 0 while the bucket is empty
+    uint64_t count;     // Estimated contended acquisitions
+    uint64_t delay_ns;  // Estimated total wait
+    uint32_t depth;
+    void *stack[MUTEX_PROFILE_DEPTH];
+} profile_bucket_t;
+
+static uint32_t profile_rate = 0;
+static spinlock_t profile_guard = SPINLOCK_INIT;
+static profile_bucket_t profile_buckets[MUTEX_PROFILE_BUCKETS];
+static profile_bucket_t profile_overflow; // Samples whose stack found no free bucket
+static FLUENT_LIBC_THREAD_LOCAL int64_t profile_countdown = -1; // Negative until first drawn
+static FLUENT_LIBC_THREAD_LOCAL uint64_t profile_seed = 0;
+
+/**
+ * @brief Contended acquisitions until the next sample: uniform in
+ * [1, 2 * rate - 1], so samples average one per `rate` without
+ * locking step with periodic workloads.
+ */
+static int64_t profile_next_countdown(const uint32_t rate) {
+    if (rate <= 1) {
+        return 1;
+    }
+    uint64_t x = profile_seed ? profile_seed : (uint64_t) mutex_thread_id() * 0x9E3779B97F4A7C15ULL | 1;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    profile_seed = x;
+    return 1 + (int64_t) (x % (2 * (uint64_t) rate - 1));
+}
+
+/**
+ * @brief A thread's first countdown: the rest of a gap already under
+ * way rather than a whole one. The smaller of two draws has about that
+ * distribution, so the first contended acquisition is sampled with
+ * probability about 1 / rate, like every later one.
+ */
+static int64_t profile_first_countdown(const uint32_t rate) {
+    const int64_t a = profile_next_countdown(rate);
+    const int64_t b = profile_next_countdown(rate);
+    return a < b ? a : b;
+}
+
+static void profile_record(void *const *stack, const uint32_t depth, const uint64_t delay_ns,
+                           const uint32_t rate) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t i = 0; i < depth; i++) {
+        hash = (hash ^ (uint64_t) (uintptr_t) stack[i]) * 0x100000001b3ULL;
+    }
+    hash |= 1;
+
+    spinlock_lock(&profile_guard);
+    size_t slot = (size_t) (hash % MUTEX_PROFILE_BUCKETS);
+    for (size_t probes = 0;; probes++, slot = (slot + 1) % MUTEX_PROFILE_BUCKETS) {
+        profile_bucket_t *b = &profile_buckets[slot];
+        if (probes == MUTEX_PROFILE_BUCKETS) {
+            // Keep the time, if not the stack
+            b = &profile_overflow;
+            b->hash = 1;
+        } else if (b->hash == 0) {
+            b->hash = hash;
+            b->depth = depth;
+            memcpy(b->stack, stack, depth * sizeof(void *));
+        } else if (b->hash != hash || b->depth != depth || memcmp(b->stack, stack, depth * sizeof(void *)) != 0) {
+            continue;
+        }
+        b->count += rate;
+        b->delay_ns += delay_ns * rate;
+        break;
+    }
+    spinlock_unlock(&profile_guard);
+}
+
+// Out of line and never a tail call from mutex_lock(), so the frame after
+// this one in a captured stack is the caller of mutex_lock()
+void mutex_lock_slow(mutex_t *m) {
+    FLUENT_SDT_PROBE1(mutex, contend_begin, m);
+    const uint32_t rate = __atomic_load_n(&profile_rate, __ATOMIC_RELAXED);
+    if (rate != 0 && profile_countdown < 0) {
+        // Sampling every thread's first contended acquisition would
+        // inflate profiles of short-lived threads
+        profile_countdown = profile_first_countdown(rate);
+    }
+    if (rate == 0 || --profile_countdown > 0) {
+        mutex_lock_contended(m);
+        FLUENT_SDT_PROBE1(mutex, contend_end, m);
+        return;
+    }
+    profile_countdown = profile_next_countdown(rate);
+
+    // Capture before waiting, so the stack walk does not add to the hold time
+    void *stack[MUTEX_PROFILE_DEPTH + 1];
+#if defined(__GLIBC__)
+    const int captured = backtrace(stack, MUTEX_PROFILE_DEPTH + 1);
+    // Start at our caller; wrappers around backtrace() may add frames
+    int skip = 1;
+    for (int i = 0; i < captured; i++) {
+        if (stack[i] == __builtin_return_address(0)) {
+            skip = i;
+            break;
+        }
+    }
+    const uint32_t depth = captured > skip ? (uint32_t) (captured - skip) : 0;
+    void *const *frames = stack + skip;
+#elif defined(_WIN32) && !defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+    const uint32_t depth = CaptureStackBackTrace(1, MUTEX_PROFILE_DEPTH, stack, NULL);
+    void *const *frames = stack;
+#elif defined(__GNUC__)
+    stack[0] = __builtin_return_address(0);
+    const uint32_t depth = 1;
+    void *const *frames = stack;
+#else
+    const uint32_t depth = 0;
+    void *const *frames = stack;
+#endif
+
+    const uint64_t start = cycleclock_now_ns();
+    mutex_lock_contended(m);
+    const uint64_t end = cycleclock_now_ns();
+    FLUENT_SDT_PROBE1(mutex, contend_end, m);
+    profile_record(frames, depth, end - start, rate);
+}
+
+void mutex_profile_set_rate(const uint32_t rate) {
+    if (rate) {
+        // Calibrate here rather than in the first sampled mutex_lock()
+        cycleclock_init();
+    }
+    __atomic_store_n(&profile_rate, rate, __ATOMIC_RELAXED);
+}
+
+uint32_t mutex_profile_rate(void) {
+    return __atomic_load_n(&profile_rate, __ATOMIC_RELAXED);
+}
+
+void mutex_profile_reset(void) {
+    spinlock_lock(&profile_guard);
+    memset(profile_buckets, 0, sizeof(profile_buckets));
+    memset(&profile_overflow, 0, sizeof(profile_overflow));
+    spinlock_unlock(&profile_guard);
+}
+
+/**
+ * @brief Copies the non-empty buckets, so formatting runs without the lock.
+ */
+static profile_bucket_t *profile_copy(size_t *n) {
+    profile_bucket_t *copy = (profile_bucket_t *) malloc(sizeof(profile_buckets) + sizeof(profile_overflow));
+    *n = 0;
+    if (!copy) {
+        return NULL;
+    }
+    spinlock_lock(&profile_guard);
+    for (size_t i = 0; i < MUTEX_PROFILE_BUCKETS; i++) {
+        if (profile_buckets[i].hash) {
+            copy[(*n)++] = profile_buckets[i];
+        }
+    }
+    if (profile_overflow.hash) {
+        copy[(*n)++] = profile_overflow;
+    }
+    spinlock_unlock(&profile_guard);
+    return copy;
+}
+
+/**
+ * @brief snprintf-style appender that keeps counting past the end.
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+} profile_out_t;
+
+static void profile_printf(profile_out_t *out, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const size_t room = out->len < out->size ? out->size - out->len : 0;
+    const int n = vsnprintf(room ? out->buf + out->len : NULL, room, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        out->len += (size_t) n;
+    }
+}
+
+/**
+ * @brief Appends a frame name: the function from backtrace_symbols()
+ * output ("binary(function+0x1f) [0x...]") where there is one, else the
+ * address.
+ */
+static void profile_frame(profile_out_t *out, void *addr, const char *symbol) {
+    const char *open = symbol ? strchr(symbol, '(') : NULL;
+    if (open && open[1] != '+' && open[1] != ')') {
+        const char *end = open + 1 + strcspn(open + 1, "+)");
+        profile_printf(out, "%.*s", (int) (end - open - 1), open + 1);
+        return;
+    }
+    profile_printf(out, "%p", addr);
+}
+
+size_t mutex_profile_write_folded(char *buf, const size_t size) {
+    profile_out_t out = { buf, buf ? size : 0, 0 };
+    if (buf && size) {
+        buf[0] = '\0';
+    }
+    size_t n;
+    profile_bucket_t *buckets = profile_copy(&n);
+    if (!buckets) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const profile_bucket_t *b = &buckets[i];
+#if defined(__GLIBC__)
+        char **symbols = b->depth ? backtrace_symbols(b->stack, (int) b->depth) : NULL;
+#else
+        char **symbols = NULL;
+#endif
+        // Root first, as flame graph tools expect
+        for (uint32_t f = b->depth; f > 0; f--) {
+            profile_frame(&out, b->stack[f - 1], symbols ? symbols[f - 1] : NULL);
+            if (f > 1) {
+                profile_printf(&out, ";");
+            }
+        }
+        if (b->depth == 0) {
+            profile_printf(&out, "[unknown]");
+        }
+        profile_printf(&out, " %llu\n", (unsigned long long) b->delay_ns);
+        free(symbols);
+    }
+    free(buckets);
+    return out.len;
+}
+
+size_t mutex_profile_write_pprof(char *buf, const size_t size) {
+    profile_out_t out = { buf, buf ? size : 0, 0 };
+    if (buf && size) {
+        buf[0] = '\0';
+    }
+    size_t n;
+    profile_bucket_t *buckets = profile_copy(&n);
+    if (!buckets) {
+        return 0;
+    }
+
+    // Samples are stored unsampled and in nanoseconds, so one "cycle" is
+    // one nanosecond and the period is 1
+    profile_printf(&out, "--- contentionz 1 ---\ncycles/second = 1000000000\nsampling period = 1\n");
+    for (size_t i = 0; i < n; i++) {
+        const profile_bucket_t *b = &buckets[i];
+        profile_printf(&out, "%llu %llu @", (unsigned long long) b->delay_ns, (unsigned long long) b->count);
+        for (uint32_t f = 0; f < b->depth; f++) {
+            profile_printf(&out, " 0x%llx", (unsigned long long) (uintptr_t) b->stack[f]);
+        }
+        profile_printf(&out, "\n");
+    }
+    free(buckets);
+
+#if defined(__linux__)
+    // Lets pprof map the addresses back to binaries and symbolize them
+    FILE *maps = fopen("/proc/self/maps", "r");
+    if (maps) {
+        char line[512];
+        profile_printf(&out, "--- Memory map: ---\n");
+        while (fgets(line, sizeof(line), maps)) {
+            profile_printf(&out, "%s", line);
+        }
+        fclose(maps);
+    }
+#endif
+    return out.len;
+}
+
+// ============= ARRAYS =============
+/**
+ * @brief Huge page size that MAP_HUGETLB requests are rounded to.
+ */
+#ifndef MUTEX_ARRAY_HUGE_PAGE
+#   define MUTEX_ARRAY_HUGE_PAGE ((size_t) 2 << 20)
+#endif
+
+/**
+ * @brief Gets `bytes` of zeroed memory, preferring huge pages.
+ *
+ * @return The memory, or NULL. *bytes may grow; *mapped tells how to free it.
+ */
+static void *mutex_array_map(size_t *bytes, int *mapped) {
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    if (*bytes >= MUTEX_ARRAY_HUGE_PAGE) {
+        const size_t huge = (*bytes + MUTEX_ARRAY_HUGE_PAGE - 1) & ~(MUTEX_ARRAY_HUGE_PAGE - 1);
+        void *p = mmap(NULL, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *bytes = huge;
+            *mapped = 1;
+            return p;
+        }
+        // No reserved huge pages: fall back to transparent ones
+    }
+#endif
+#if !defined(_WIN32)
+    void *p = mmap(NULL, *bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED) {
+#   ifdef MADV_HUGEPAGE
+        madvise(p, *bytes, MADV_HUGEPAGE);
+#   endif
+        *mapped = 1;
+        return p;
+    }
+    return NULL;
+#elif !defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+    // Large pages need SeLockMemoryPrivilege, so use regular committed pages
+    void *p = VirtualAlloc(NULL, *bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    *mapped = p != NULL;
+    return p;
+#else
+    *mapped = 0;
+    return malloc(*bytes);
+#endif
+}
+
+static void mutex_array_unmap(void *base, const size_t bytes, const int mapped) {
+    if (!mapped) {
+        free(base);
+        return;
+    }
+#if !defined(_WIN32)
+    munmap(base, bytes);
+#elif !defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+    (void) bytes;
+    VirtualFree(base, 0, MEM_RELEASE);
+#endif
+}
+
+typedef struct {
+    char *from;
+    size_t bytes;
+} mutex_array_chunk_t;
+
+static void *mutex_array_zero(void *arg) {
+    const mutex_array_chunk_t *chunk = (const mutex_array_chunk_t *) arg;
+    // Writing faults the pages in now rather than on first lock
+    memset(chunk->from, 0, chunk->bytes);
+    return NULL;
+}
+
+/**
+ * @brief Zeroes [from, from + bytes) with up to `threads` threads.
+ */
+static void mutex_array_zero_parallel(char *from, const size_t bytes, unsigned threads) {
+    if (threads > 64) {
+        threads = 64;
+    }
+    mutex_array_chunk_t chunks[64];
+#ifndef _WIN32
+    pthread_t helpers[64];
+    int started[64] = { 0 };
+#endif
+
+    // Page-aligned chunks keep each page on one thread
+    const size_t page = 4096;
+    size_t per = (bytes / (threads ? threads : 1) + page - 1) & ~(page - 1);
+    if (per == 0) {
+        per = page;
+    }
+
+    unsigned used = 0;
+    for (size_t off = 0; off < bytes && used < 64; off += per, used++) {
+        chunks[used].from = from + off;
+        chunks[used].bytes = bytes - off < per ? bytes - off : per;
+    }
+
+#ifndef _WIN32
+    for (unsigned i = 1; i < used; i++) {
+        started[i] = pthread_create(&helpers[i], NULL, mutex_array_zero, &chunks[i]) == 0;
+    }
+#endif
+    for (unsigned i = 0; i < used; i++) {
+#ifndef _WIN32
+        if (started[i]) {
+            continue;
+        }
+#endif
+        mutex_array_zero(&chunks[i]);
+    }
+#ifndef _WIN32
+    for (unsigned i = 1; i < used; i++) {
+        if (started[i]) {
+            pthread_join(helpers[i], NULL);
+        }
+    }
+#endif
+}
+
+mutex_t *mutex_array_create_ex(const size_t n, size_t alignment, const unsigned threads) {
+    if (n == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (alignment < sizeof(uint64_t)) {
+        alignment = sizeof(uint64_t);
+    }
+
+    const size_t stride = (sizeof(mutex_t) + alignment - 1) & ~(alignment - 1);
+    const size_t extra = sizeof(mutex_array_header_t) + alignment;
+    if (n > ((size_t) -1 - extra) / stride) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    size_t bytes = n * stride + extra;
+    int mapped = 0;
+    char *base = (char *) mutex_array_map(&bytes, &mapped);
+    if (!base) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    const uintptr_t first = ((uintptr_t) base + sizeof(mutex_array_header_t) + alignment - 1)
+                            & ~(uintptr_t) (alignment - 1);
+    mutex_t *array = (mutex_t *) first;
+
+    // All-zero is an unlocked default mutex, so zeroing is the whole init.
+    // Fresh mappings are zero already and only need touching to prefault.
+    if (threads > 0 || !mapped) {
+        mutex_array_zero_parallel((char *) array, n * stride, threads ? threads : 1);
+    }
+
+    mutex_array_header_t *h = (mutex_array_header_t *) array - 1;
+    h->base = base;
+    h->bytes = bytes;
+    h->count = n;
+    h->stride = stride;
+    h->mapped = mapped;
+
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+    mutex_debug_on_array_init(array, n);
+#endif
+    return array;
+}
+
+mutex_t *mutex_array_create(const size_t n, const size_t alignment) {
+    return mutex_array_create_ex(n, alignment, 0);
+}
+
+// Parenthesized so that the debug-build macro does not expand here
+void (mutex_array_destroy)(mutex_t *array) {
+    if (!array) {
+        return;
+    }
+    const mutex_array_header_t h = *((const mutex_array_header_t *) array - 1);
+    mutex_array_unmap(h.base, h.bytes, h.mapped);
+}
+
+#ifdef FLUENT_LIBC_MUTEX_WATCHDOG
+#include "wait.h"
+
+// ============= HOLD-TIME WATCHDOG =============
+typedef struct {
+    mutex_t *lock;
+    const char *name;
+    uint64_t reported_since;  // Acquisition already reported, 0 if none
+} watch_entry_t;
+
+static spinlock_t watch_guard = SPINLOCK_INIT;
+static watch_entry_t *watch_entries = NULL;
+static size_t watch_count = 0;
+static size_t watch_cap = 0;
+
+static uint32_t watchdog_stop_word = 0;
+static int watchdog_running = 0;
+// Settings of the current run; written and read under watch_guard
+static uint64_t watchdog_threshold_ns = 0;
+static uint64_t watchdog_interval_ns = 0;
+static mutex_watchdog_handler_t watchdog_handler = NULL;
+static void *watchdog_arg = NULL;
+#ifdef _WIN32
+static HANDLE watchdog_thread;
+#else
+static pthread_t watchdog_thread;
+#endif
+
+__attribute__((noinline))
+void mutex_watchdog_on_acquired(mutex_t *m) {
+    // Never inlined, so the return address lies in the caller of mutex_lock()
+    // (mutex_lock() itself is inlined there)
+    __atomic_store_n(&m->watch_site, __builtin_return_address(0), __ATOMIC_RELAXED);
+    // Every acquisition lands here, registered or not; until the watchdog
+    // is set up, stamp with the monotonic clock (same epoch) instead of
+    // calibrating with the lock held
+    const uint64_t now = __atomic_load_n(&cycleclock_state.source, __ATOMIC_ACQUIRE) == CYCLECLOCK_UNCALIBRATED
+                             ? parking_lot_now_ns()
+                             : cycleclock_now_ns();
+    __atomic_store_n(&m->watch_since_ns, now, __ATOMIC_RELEASE);
+}
+
+int mutex_watchdog_register(mutex_t *m, const char *name) {
+    cycleclock_init();
+    int err = 0;
+    spinlock_lock(&watch_guard);
+    if (watch_count == watch_cap) {
+        const size_t cap = watch_cap ? watch_cap * 2 : 16;
+        watch_entry_t *grown = (watch_entry_t *) realloc(watch_entries, cap * sizeof(watch_entry_t));
+        if (grown) {
+            watch_entries = grown;
+            watch_cap = cap;
+        } else {
+            err = ENOMEM;
+        }
+    }
+    if (err == 0) {
+        watch_entries[watch_count].lock = m;
+        watch_entries[watch_count].name = name;
+        watch_entries[watch_count].reported_since = 0;
+        watch_count++;
+    }
+    spinlock_unlock(&watch_guard);
+    return err;
+}
+
+void mutex_watchdog_unregister(mutex_t *m) {
+    spinlock_lock(&watch_guard);
+    for (size_t i = 0; i < watch_count; i++) {
+        if (watch_entries[i].lock == m) {
+            watch_entries[i] = watch_entries[--watch_count];
+            break;
+        }
+    }
+    spinlock_unlock(&watch_guard);
+}
+
+static void watchdog_log(const mutex_watchdog_report_t *report, void *arg) {
+    (void) arg;
+    fprintf(stderr, "mutex watchdog: %p%s%s%s held for %.3f ms by thread %llu, acquired at %p\n",
+            (const void *) report->lock,
+            report->name ? " (" : "", report->name ? report->name : "", report->name ? ")" : "",
+            (double) report->held_ns / 1e6, (unsigned long long) report->owner, report->site);
+#if defined(__GLIBC__)
+    // One line with the symbol, when the binary exports it (-rdynamic)
+    void *site = report->site;
+    backtrace_symbols_fd(&site, 1, 2);
+#endif
+}
+
+/**
+ * @brief Scans the watched set once and reports new long holds.
+ *
+ * Reports are collected under the registry lock and delivered after it
+ * is dropped, so handlers may (un)register mutexes.
+ */
+static void watchdog_scan(void) {
+    mutex_watchdog_report_t *reports = NULL;
+    size_t found = 0;
+    const uint64_t now = cycleclock_now_ns();
+
+    spinlock_lock(&watch_guard);
+    const mutex_watchdog_handler_t handler = watchdog_handler ? watchdog_handler : watchdog_log;
+    void *const arg = watchdog_arg;
+    for (size_t i = 0; i < watch_count; i++) {
+        watch_entry_t *e = &watch_entries[i];
+        const uint64_t since = __atomic_load_n(&e->lock->watch_since_ns, __ATOMIC_ACQUIRE);
+        if (since == 0 || since == e->reported_since || now < since
+            || now - since < watchdog_threshold_ns) {
+            continue;
+        }
+        const uintptr_t owner = __atomic_load_n(&e->lock->owner, __ATOMIC_RELAXED);
+        void *site = __atomic_load_n(&e->lock->watch_site, __ATOMIC_RELAXED);
+        // Owner and site must belong to the acquisition stamped `since`
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&e->lock->watch_since_ns, __ATOMIC_RELAXED) != since || owner == 0) {
+            continue;
+        }
+
+        if (found % 16 == 0) {
+            mutex_watchdog_report_t *grown = (mutex_watchdog_report_t *)
+                realloc(reports, (found + 16) * sizeof(mutex_watchdog_report_t));
+            if (!grown) {
+                break;
+            }
+            reports = grown;
+        }
+        reports[found].lock = e->lock;
+        reports[found].name = e->name;
+        reports[found].owner = owner;
+        reports[found].held_ns = now - since;
+        reports[found].site = site;
+        found++;
+        e->reported_since = since;
+    }
+    spinlock_unlock(&watch_guard);
+
+    for (size_t i = 0; i < found; i++) {
+        handler(&reports[i], arg);
+    }
+    free(reports);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI watchdog_main(LPVOID arg) {
+#else
+static void *watchdog_main(void *arg) {
+#endif
+    (void) arg;
+    spinlock_lock(&watch_guard);
+    const uint64_t interval_ns = watchdog_interval_ns;
+    spinlock_unlock(&watch_guard);
+    while (__atomic_load_n(&watchdog_stop_word, __ATOMIC_ACQUIRE) == 0) {
+        wait_on_address(&watchdog_stop_word, 0, interval_ns);
+        if (__atomic_load_n(&watchdog_stop_word, __ATOMIC_ACQUIRE) == 0) {
+            watchdog_scan();
+        }
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int mutex_watchdog_start(const uint64_t threshold_ns, const uint64_t interval_ns,
+                         const mutex_watchdog_handler_t handler, void *arg) {
+    if (interval_ns == 0) {
+        return EINVAL;
+    }
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&watchdog_running, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return EBUSY;
+    }
+    cycleclock_init();
+
+    spinlock_lock(&watch_guard);
+    watchdog_threshold_ns = threshold_ns;
+    watchdog_interval_ns = interval_ns;
+    watchdog_handler = handler;
+    watchdog_arg = arg;
+    spinlock_unlock(&watch_guard);
+    __atomic_store_n(&watchdog_stop_word, 0, __ATOMIC_RELEASE);
+
+#ifdef _WIN32
+    watchdog_thread = CreateThread(NULL, 0, watchdog_main, NULL, 0, NULL);
+    const int ok = watchdog_thread != NULL;
+#else
+    const int ok = pthread_create(&watchdog_thread, NULL, watchdog_main, NULL) == 0;
+#endif
+    if (!ok) {
+        __atomic_store_n(&watchdog_running, 0, __ATOMIC_RELEASE);
+        return EAGAIN;
+    }
+    return 0;
+}
+
+void mutex_watchdog_stop(void) {
+    if (__atomic_load_n(&watchdog_running, __ATOMIC_ACQUIRE) != 1) {
+        return;
+    }
+    __atomic_store_n(&watchdog_stop_word, 1, __ATOMIC_RELEASE);
+    wake_all(&watchdog_stop_word);
+#ifdef _WIN32
+    WaitForSingleObject(watchdog_thread, INFINITE);
+    CloseHandle(watchdog_thread);
+#else
+    pthread_join(watchdog_thread, NULL);
+#endif
+    __atomic_store_n(&watchdog_running, 0, __ATOMIC_RELEASE);
+}
+#endif
+
+#ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+#include "histogram.h"
+
+// ============= WAIT / HOLD HISTOGRAMS =============
+/**
+ * @brief Both histograms of an instrumented mutex, allocated together.
+ */
+typedef struct {
+    histogram_t wait;     // mutex_t::wait_hist points here
+    histogram_t hold;
+    uint64_t enabled_ns;  // When recording started
+} mutex_histograms_t;
+
+void mutex_histogram_on_acquired(mutex_t *m, const uint64_t wait_start_ns) {
+    const uint64_t now = cycleclock_now_ns();
+    histogram_record(__atomic_load_n(&m->wait_hist, __ATOMIC_RELAXED),
+                     wait_start_ns && now > wait_start_ns ? now - wait_start_ns : 0);
+    m->hist_since_ns = now;
+}
+
+void mutex_histogram_on_release(mutex_t *m) {
+    histogram_t *hold = __atomic_load_n(&m->hold_hist, __ATOMIC_ACQUIRE);
+    const uint64_t now = cycleclock_now_ns();
+    if (hold && now > m->hist_since_ns) {
+        histogram_record(hold, now - m->hist_since_ns);
+    }
+    m->hist_since_ns = 0;
+}
+
+int mutex_histogram_enable(mutex_t *m) {
+    if (__atomic_load_n(&m->wait_hist, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    cycleclock_init();
+    mutex_histograms_t *h = (mutex_histograms_t *) malloc(sizeof(mutex_histograms_t));
+    if (!h) {
+        return ENOMEM;
+    }
+    histogram_init(&h->wait, MUTEX_HISTOGRAM_MAX_NS, MUTEX_HISTOGRAM_DIGITS);
+    histogram_init(&h->hold, MUTEX_HISTOGRAM_MAX_NS, MUTEX_HISTOGRAM_DIGITS);
+    h->enabled_ns = cycleclock_now_ns();
+
+    struct histogram *expected = NULL;
+    if (!__atomic_compare_exchange_n(&m->wait_hist, &expected, &h->wait, 0,
+                                     __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        // Enabled concurrently
+        histogram_destroy(&h->wait);
+        histogram_destroy(&h->hold);
+        free(h);
+        return 0;
+    }
+    __atomic_store_n(&m->hold_hist, &h->hold, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void mutex_histogram_disable(mutex_t *m) {
+    mutex_histograms_t *h = (mutex_histograms_t *) m->wait_hist;
+    if (!h) {
+        return;
+    }
+    m->wait_hist = NULL;
+    m->hold_hist = NULL;
+    m->hist_since_ns = 0;
+    histogram_destroy(&h->wait);
+    histogram_destroy(&h->hold);
+    free(h);
+}
+
+/**
+ * @brief Snapshots both histograms of an instrumented mutex.
+ */
+static mutex_histograms_t *mutex_histogram_snapshots(const mutex_t *m, histogram_snapshot_t *wait,
+                                                     histogram_snapshot_t *hold) {
+    mutex_histograms_t *h = (mutex_histograms_t *) __atomic_load_n(&m->wait_hist, __ATOMIC_ACQUIRE);
+    if (!h || histogram_snapshot(&h->wait, wait) != 0) {
+        return NULL;
+    }
+    if (histogram_snapshot(&h->hold, hold) != 0) {
+        histogram_snapshot_free(wait);
+        return NULL;
+    }
+    return h;
+}
+
+size_t mutex_histogram_format(const mutex_t *m, const char *name, const double unit_ratio,
+                              char *buf, const size_t size) {
+    histogram_snapshot_t snaps[2];
+    if (!mutex_histogram_snapshots(m, &snaps[0], &snaps[1])) {
+        return 0;
+    }
+
+    static const char *kinds[2] = { "wait", "hold" };
+    size_t len = 0;
+    for (int k = 0; k < 2; k++) {
+        char *at = buf && len < size ? buf + len : NULL;
+        const size_t room = at ? size - len : 0;
+        len += (size_t) snprintf(at, room, "%s# %s %s\n", k ? "\n" : "", name, kinds[k]);
+        at = buf && len < size ? buf + len : NULL;
+        len += histogram_format(&snaps[k], unit_ratio, at, at ? size - len : 0);
+        histogram_snapshot_free(&snaps[k]);
+    }
+    return len;
+}
+
+size_t mutex_histogram_export(const mutex_t *m, const char *name, char *buf, const size_t size) {
+    histogram_snapshot_t snaps[2];
+    const mutex_histograms_t *h = mutex_histogram_snapshots(m, &snaps[0], &snaps[1]);
+    if (!h) {
+        return 0;
+    }
+    const double interval = (double) (cycleclock_now_ns() - h->enabled_ns) / 1e9;
+
+    static const char *kinds[2] = { "wait", "hold" };
+    size_t len = 0;
+    int ok = 1;
+    for (int k = 0; k < 2; k++) {
+        const size_t encoded = ok ? histogram_encode(&snaps[k], NULL, 0) : 0;
+        char *b64 = encoded ? (char *) malloc(encoded + 1) : NULL;
+        if (b64) {
+            histogram_encode(&snaps[k], b64, encoded + 1);
+            char *at = buf && len < size ? buf + len : NULL;
+            len += (size_t) snprintf(at, at ? size - len : 0, "Tag=%s.%s,0.000,%.3f,%.3f,%s\n", name, kinds[k],
+                                     interval, (double) histogram_max(&snaps[k]) / 1e6, b64);
+            free(b64);
+        } else {
+            ok = 0;
+        }
+        histogram_snapshot_free(&snaps[k]);
+    }
+    return ok ? len : 0;
+}
+#endif
+
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+// ============= LOCK-ORDER CHECKER =============
+// The graph is guarded by a plain OS lock rather than a mutex_t,
+// so the checker never observes its own locking.
+#ifdef _WIN32
+static SRWLOCK graph_guard = SRWLOCK_INIT;
+#   define GRAPH_LOCK()   AcquireSRWLockExclusive(&graph_guard)
+#   define GRAPH_UNLOCK() ReleaseSRWLockExclusive(&graph_guard)
+#else
+static pthread_mutex_t graph_guard = PTHREAD_MUTEX_INITIALIZER;
+#   define GRAPH_LOCK()   pthread_mutex_lock(&graph_guard)
+#   define GRAPH_UNLOCK() pthread_mutex_unlock(&graph_guard)
+#endif
+
+/**
+ * @brief Per-thread checker state: the stack of held locks.
+ *
+ * Its address doubles as the thread's identity in mutex_t::debug_owner.
+ */
+typedef struct {
+    mutex_debug_held_t held[MUTEX_DEBUG_MAX_HELD];
+    unsigned long long ids[MUTEX_DEBUG_MAX_HELD];
+    size_t depth;     // Tracked entries in `held`
+    size_t overflow;  // Locks held beyond MUTEX_DEBUG_MAX_HELD (untracked)
+} debug_thread_t;
+
+/**
+ * @brief Outgoing edge of a graph node.
+ */
+typedef struct {
+    unsigned long long to;
+    mutex_site_t from_site;
+    mutex_site_t to_site;
+} graph_edge_t;
+
+/**
+ * @brief Graph node, one per live mutex_t.
+ */
+typedef struct {
+    unsigned long long id;     // 0 = empty slot, GRAPH_TOMBSTONE = removed
+    const mutex_t *lock;
+    graph_edge_t *edges;
+    size_t edge_count;
+    size_t edge_cap;
+    // Scratch state of the cycle search
+    unsigned long long visit_gen;
+    size_t parent;             // Slot we were reached from
+    size_t parent_edge;        // Index of the edge in the parent's list
+} graph_node_t;
+
+#define GRAPH_TOMBSTONE (~0ULL)
+#define GRAPH_NONE      ((size_t) -1)
+
+static FLUENT_LIBC_THREAD_LOCAL debug_thread_t debug_thread;
+static mutex_debug_handler_t debug_handler = NULL;
+
+static graph_node_t *graph_nodes = NULL;
+static size_t graph_cap = 0;        // Slot count, always a power of two
+static size_t graph_used = 0;       // Live nodes
+static size_t graph_filled = 0;     // Live nodes plus tombstones
+static unsigned long long graph_next_id = 1;
+static unsigned long long graph_gen = 0;
+
+static size_t graph_hash(const unsigned long long id) {
+    unsigned long long h = id * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (h ^ (h >> 29));
+}
+
+static size_t graph_find(const unsigned long long id) {
+    if (graph_cap == 0 || id == 0) {
+        return GRAPH_NONE;
+    }
+
+    size_t i = graph_hash(id) & (graph_cap - 1);
+    while (graph_nodes[i].id != 0) {
+        if (graph_nodes[i].id == id) {
+            return i;
+        }
+        i = (i + 1) & (graph_cap - 1);
+    }
+
+    return GRAPH_NONE;
+}
+
+static void graph_place(const graph_node_t *node) {
+    size_t i = graph_hash(node->id) & (graph_cap - 1);
+    while (graph_nodes[i].id != 0) {
+        i = (i + 1) & (graph_cap - 1);
+    }
+    graph_nodes[i] = *node;
+}
+
+static int graph_rehash(void) {
+    // Rehashing drops tombstones; only double when live nodes need it
+    size_t new_cap = graph_cap ? graph_cap : 64;
+    if ((graph_used + 1) * 4 > new_cap) {
+        new_cap *= 2;
+    }
+
+    graph_node_t *old = graph_nodes;
+    const size_t old_cap = graph_cap;
+
+    graph_node_t *fresh = (graph_node_t *) calloc(new_cap, sizeof(graph_node_t));
+    if (!fresh) {
+        return -1;
+    }
+
+    graph_nodes = fresh;
+    graph_cap = new_cap;
+    graph_filled = graph_used;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].id != 0 && old[i].id != GRAPH_TOMBSTONE) {
+            graph_place(&old[i]);
+        }
+    }
+
+    free(old);
+    return 0;
+}
+
+static size_t graph_insert(const unsigned long long id, const mutex_t *lock) {
+    // Keep the load (including tombstones) under 50%
+    if ((graph_filled + 1) * 2 > graph_cap) {
+        if (graph_rehash() != 0) {
+            return GRAPH_NONE;
+        }
+    }
+
+    graph_node_t node;
+    memset(&node, 0, sizeof(node));
+    node.id = id;
+    node.lock = lock;
+    graph_place(&node);
+    graph_used++;
+    graph_filled++;
+    return graph_find(id);
+}
+
+static int graph_id_cmp(const void *a, const void *b) {
+    const unsigned long long x = *(const unsigned long long *) a;
+    const unsigned long long y = *(const unsigned long long *) b;
+    return x < y ? -1 : x > y;
+}
+
+static void graph_tombstone(const unsigned long long id, size_t *removed) {
+    const size_t slot = graph_find(id);
+    if (slot == GRAPH_NONE) {
+        return;
+    }
+
+    free(graph_nodes[slot].edges);
+    memset(&graph_nodes[slot], 0, sizeof(graph_node_t));
+    graph_nodes[slot].id = GRAPH_TOMBSTONE;
+    graph_used--;
+    (*removed)++;
+}
+
+/**
+ * @brief Removes the nodes with ids in [first, last] or in the sorted
+ * `ids`, and every edge to them, in one sweep of the edges.
+ */
+static void graph_remove_set(const unsigned long long first, const unsigned long long last,
+                             const unsigned long long *ids, const size_t n) {
+    size_t removed = 0;
+    for (unsigned long long id = first; id != 0 && id <= last; id++) {
+        graph_tombstone(id, &removed);
+    }
+    for (size_t i = 0; i < n; i++) {
+        graph_tombstone(ids[i], &removed);
+    }
+    if (removed == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < graph_cap; i++) {
+        graph_node_t *node = &graph_nodes[i];
+        if (node->id == 0 || node->id == GRAPH_TOMBSTONE) {
+            continue;
+        }
+
+        size_t kept = 0;
+        for (size_t e = 0; e < node->edge_count; e++) {
+            const unsigned long long to = node->edges[e].to;
+            if ((to < first || to > last)
+                && !(n && bsearch(&to, ids, n, sizeof(*ids), graph_id_cmp))) {
+                node->edges[kept++] = node->edges[e];
+            }
+        }
+        node->edge_count = kept;
+    }
+}
+
+static void graph_remove(const unsigned long long id) {
+    graph_remove_set(id, id, NULL, 0);
+}
+
+static int graph_has_edge(const graph_node_t *from, const unsigned long long to) {
+    for (size_t e = 0; e < from->edge_count; e++) {
+        if (from->edges[e].to == to) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void graph_add_edge(graph_node_t *from, const graph_edge_t *edge) {
+    if (from->edge_count == from->edge_cap) {
+        const size_t cap = from->edge_cap ? from->edge_cap * 2 : 4;
+        graph_edge_t *edges = (graph_edge_t *) realloc(from->edges, cap * sizeof(graph_edge_t));
+        if (!edges) {
+            return; // Out of memory: lose the edge rather than the program
+        }
+        from->edges = edges;
+        from->edge_cap = cap;
+    }
+
+    from->edges[from->edge_count++] = *edge;
+}
+
+/**
+ * @brief Depth-first search for a path from `start` to `target`.
+ *
+ * On success the path can be walked backwards from `target` through the
+ * nodes' parent links.
+ */
+static int graph_reaches(const size_t start, const size_t target) {
+    size_t *stack = (size_t *) malloc(graph_used * sizeof(size_t));
+    if (!stack) {
+        return 0;
+    }
+
+    const unsigned long long gen = ++graph_gen;
+    size_t top = 0;
+    graph_nodes[start].visit_gen = gen;
+    graph_nodes[start].parent = GRAPH_NONE;
+    stack[top++] = start;
+
+    while (top > 0) {
+        const size_t slot = stack[--top];
+        if (slot == target) {
+            free(stack);
+            return 1;
+        }
+
+        const graph_node_t *n = &graph_nodes[slot];
+        for (size_t e = 0; e < n->edge_count; e++) {
+            const size_t next = graph_find(n->edges[e].to);
+            if (next == GRAPH_NONE || graph_nodes[next].visit_gen == gen) {
+                continue;
+            }
+
+            graph_nodes[next].visit_gen = gen;
+            graph_nodes[next].parent = slot;
+            graph_nodes[next].parent_edge = e;
+            stack[top++] = next;
+        }
+    }
+
+    free(stack);
+    return 0;
+}
+
+static const char *debug_kind_name(const mutex_debug_kind_t kind) {
+    switch (kind) {
+        case MUTEX_DEBUG_ORDER_CYCLE:      return "lock order inversion (possible deadlock)";
+        case MUTEX_DEBUG_DOUBLE_LOCK:      return "double lock";
+        case MUTEX_DEBUG_UNLOCK_NOT_OWNER: return "unlock by non-owner";
+        case MUTEX_DEBUG_DESTROY_LOCKED:   return "destroy while locked";
+    }
+    return "unknown";
+}
+
+static void debug_print_site(const char *label, const mutex_site_t *site) {
+    if (site->file) {
+        fprintf(stderr, "  %s %s:%d (%s)\n", label, site->file, site->line, site->func);
+    }
+}
+
+static void debug_default_handler(const mutex_debug_report_t *report) {
+    fprintf(stderr, "mutex: %s on %p\n", debug_kind_name(report->kind), (const void *) report->lock);
+    debug_print_site("at", &report->site);
+    debug_print_site("owner acquired it at", &report->owner_site);
+
+    if (report->chain_len > 0) {
+        fprintf(stderr, "  existing lock order:\n");
+        for (size_t i = 0; i < report->chain_len; i++) {
+            const mutex_debug_edge_t *e = &report->chain[i];
+            fprintf(stderr, "    %p -> %p\n", (const void *) e->from, (const void *) e->to);
+            debug_print_site("  held since", &e->from_site);
+            debug_print_site("  acquired at", &e->to_site);
+        }
+    }
+
+    if (report->held_count > 0) {
+        fprintf(stderr, "  locks held by this thread:\n");
+        for (size_t i = 0; i < report->held_count; i++) {
+            fprintf(stderr, "    %p\n", (const void *) report->held[i].lock);
+            debug_print_site("  acquired at", &report->held[i].site);
+        }
+    }
+
+    fflush(stderr);
+    if (report->kind == MUTEX_DEBUG_DOUBLE_LOCK) {
+        abort();
+    }
+}
+
+static void debug_report(mutex_debug_report_t *report) {
+    report->held = debug_thread.held;
+    report->held_count = debug_thread.depth;
+
+    const mutex_debug_handler_t handler = __atomic_load_n(&debug_handler, __ATOMIC_ACQUIRE);
+    (handler ? handler : debug_default_handler)(report);
+}
+
+void mutex_debug_set_handler(const mutex_debug_handler_t handler) {
+    __atomic_store_n(&debug_handler, handler, __ATOMIC_RELEASE);
+}
+
+void mutex_debug_on_init(mutex_t *m) {
+    GRAPH_LOCK();
+    // Re-initialized without a destroy; uninitialized memory may hold any
+    // id, so only drop the node if it really is this mutex's
+    if (m->debug_id != 0) {
+        const size_t slot = graph_find(m->debug_id);
+        if (slot != GRAPH_NONE && graph_nodes[slot].lock == m) {
+            graph_remove(m->debug_id);
+        }
+    }
+    m->debug_id = graph_next_id++;
+    graph_insert(m->debug_id, m);
+    GRAPH_UNLOCK();
+
+    m->debug_owner = NULL;
+    memset(&m->debug_site, 0, sizeof(m->debug_site));
+}
+
+void mutex_debug_on_lock(mutex_t *m, const mutex_site_t site) {
+    debug_thread_t *self = &debug_thread;
+
+    if (__atomic_load_n(&m->debug_owner, __ATOMIC_RELAXED) == self) {
+        mutex_debug_report_t report;
+        memset(&report, 0, sizeof(report));
+        report.kind = MUTEX_DEBUG_DOUBLE_LOCK;
+        report.lock = m;
+        report.site = site;
+        report.owner_site = m->debug_site;
+        debug_report(&report);
+        return;
+    }
+
+    mutex_debug_edge_t *chain = NULL;
+    size_t chain_len = 0;
+    mutex_debug_held_t culprit;
+    memset(&culprit, 0, sizeof(culprit));
+
+    GRAPH_LOCK();
+    if (m->debug_id == 0) {
+        // Zero-filled or static mutex that never went through mutex_init()
+        m->debug_id = graph_next_id++;
+        graph_insert(m->debug_id, m);
+    }
+    const size_t to = graph_find(m->debug_id);
+    for (size_t i = 0; to != GRAPH_NONE && i < self->depth && !chain; i++) {
+        const size_t from = graph_find(self->ids[i]);
+        if (from == GRAPH_NONE || graph_has_edge(&graph_nodes[from], m->debug_id)) {
+            continue;
+        }
+
+        if (graph_reaches(to, from)) {
+            // Walk back from the held lock to `m` to collect the recorded order
+            for (size_t s = from; s != to; s = graph_nodes[s].parent) {
+                chain_len++;
+            }
+
+            chain = (mutex_debug_edge_t *) malloc(chain_len * sizeof(mutex_debug_edge_t));
+            if (chain) {
+                size_t k = chain_len;
+                for (size_t s = from; s != to; s = graph_nodes[s].parent) {
+                    const graph_node_t *p = &graph_nodes[graph_nodes[s].parent];
+                    const graph_edge_t *e = &p->edges[graph_nodes[s].parent_edge];
+                    chain[--k] = (mutex_debug_edge_t) { p->lock, graph_nodes[s].lock, e->from_site, e->to_site };
+                }
+                culprit = self->held[i];
+            }
+            continue;
+        }
+
+        const graph_edge_t edge = { m->debug_id, self->held[i].site, site };
+        graph_add_edge(&graph_nodes[from], &edge);
+    }
+    GRAPH_UNLOCK();
+
+    if (chain) {
+        mutex_debug_report_t report;
+        memset(&report, 0, sizeof(report));
+        report.kind = MUTEX_DEBUG_ORDER_CYCLE;
+        report.lock = m;
+        report.site = site;
+        report.owner_site = culprit.site;
+        report.chain = chain;
+        report.chain_len = chain_len;
+        debug_report(&report);
+        free(chain);
+    }
+}
+
+void mutex_debug_on_acquired(mutex_t *m, const mutex_site_t site) {
+    debug_thread_t *self = &debug_thread;
+
+    m->debug_site = site;
+    __atomic_store_n(&m->debug_owner, (void *) self, __ATOMIC_RELAXED);
+
+    if (self->depth == MUTEX_DEBUG_MAX_HELD) {
+        self->overflow++;
+        return;
+    }
+
+    self->held[self->depth].lock = m;
+    self->held[self->depth].site = site;
+    self->ids[self->depth] = m->debug_id;
+    self->depth++;
+}
+
+void mutex_debug_on_unlock(mutex_t *m, const mutex_site_t site) {
+    debug_thread_t *self = &debug_thread;
+
+    if (__atomic_load_n(&m->debug_owner, __ATOMIC_RELAXED) != self) {
+        mutex_debug_report_t report;
+        memset(&report, 0, sizeof(report));
+        report.kind = MUTEX_DEBUG_UNLOCK_NOT_OWNER;
+        report.lock = m;
+        report.site = site;
+        report.owner_site = m->debug_site;
+        debug_report(&report);
+        return;
+    }
+
+    __atomic_store_n(&m->debug_owner, NULL, __ATOMIC_RELAXED);
+
+    // Locks may be released in any order; remove the newest matching entry
+    for (size_t i = self->depth; i-- > 0;) {
+        if (self->held[i].lock == m) {
+            memmove(&self->held[i], &self->held[i + 1], (self->depth - i - 1) * sizeof(mutex_debug_held_t));
+            memmove(&self->ids[i], &self->ids[i + 1], (self->depth - i - 1) * sizeof(unsigned long long));
+            self->depth--;
+            return;
+        }
+    }
+
+    if (self->overflow > 0) {
+        self->overflow--;
+    }
+}
+
+void mutex_debug_on_destroy(mutex_t *m, const mutex_site_t site) {
+    if (__atomic_load_n(&m->debug_owner, __ATOMIC_RELAXED) != NULL) {
+        mutex_debug_report_t report;
+        memset(&report, 0, sizeof(report));
+        report.kind = MUTEX_DEBUG_DESTROY_LOCKED;
+        report.lock = m;
+        report.site = site;
+        report.owner_site = m->debug_site;
+        debug_report(&report);
+    }
+
+    GRAPH_LOCK();
+    graph_remove(m->debug_id);
+    GRAPH_UNLOCK();
+}
+
+void mutex_debug_on_array_init(mutex_t *array, const size_t n) {
+    // One locked section, so the array's ids form a contiguous range
+    mutex_array_header_t *h = (mutex_array_header_t *) array - 1;
+    GRAPH_LOCK();
+    h->debug_first = graph_next_id;
+    for (size_t i = 0; i < n; i++) {
+        mutex_t *m = mutex_array_at(array, i);
+        m->debug_id = graph_next_id++;
+        graph_insert(m->debug_id, m);
+    }
+    h->debug_last = graph_next_id - 1;
+    GRAPH_UNLOCK();
+}
+
+void mutex_debug_array_destroy(mutex_t *array, const char *file, const int line, const char *func) {
+    if (array) {
+        const mutex_site_t site = { file, line, func };
+        const mutex_array_header_t *h = (const mutex_array_header_t *) array - 1;
+        const size_t n = h->count;
+        for (size_t i = 0; i < n; i++) {
+            mutex_t *m = mutex_array_at(array, i);
+            if (__atomic_load_n(&m->debug_owner, __ATOMIC_RELAXED) != NULL) {
+                mutex_debug_report_t report;
+                memset(&report, 0, sizeof(report));
+                report.kind = MUTEX_DEBUG_DESTROY_LOCKED;
+                report.lock = m;
+                report.site = site;
+                report.owner_site = m->debug_site;
+                debug_report(&report);
+            }
+        }
+
+        // Elements passed to mutex_init() since creation carry ids from
+        // outside the creation range; their original ids are still in it
+        unsigned long long *strays = NULL;
+        size_t stray_count = 0;
+        int strays_lost = 0;
+        for (size_t i = 0; i < n; i++) {
+            const unsigned long long id = mutex_array_at(array, i)->debug_id;
+            if (id >= h->debug_first && id <= h->debug_last) {
+                continue;
+            }
+            if (!strays) {
+                strays = (unsigned long long *) malloc(n * sizeof(*strays));
+                if (!strays) {
+                    strays_lost = 1;
+                    break;
+                }
+            }
+            strays[stray_count++] = id;
+        }
+        if (stray_count > 1) {
+            qsort(strays, stray_count, sizeof(*strays), graph_id_cmp);
+        }
+
+        GRAPH_LOCK();
+        if (strays_lost) {
+            // No memory for the list: one sweep per stray instead
+            for (size_t i = 0; i < n; i++) {
+                const unsigned long long id = mutex_array_at(array, i)->debug_id;
+                if (id < h->debug_first || id > h->debug_last) {
+                    graph_remove(id);
+                }
+            }
+        }
+        graph_remove_set(h->debug_first, h->debug_last, strays, stray_count);
+        GRAPH_UNLOCK();
+        free(strays);
+    }
+    (mutex_array_destroy)(array);
+}
+#endif // FLUENT_LIBC_MUTEX_DEBUG
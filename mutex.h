@@ -17,13 +17,24 @@
 // Cross-platform mutex abstraction for thread synchronization.
 // This library provides a simple way to create, lock, unlock,
 // and destroy mutexes in a platform-independent manner.
-// Internally, it uses CRITICAL_SECTION on Windows and pthread_mutex_t on POSIX systems.
+// Internally, a mutex is a 32-bit lock word: the uncontended paths are a
+// single atomic instruction, and contended threads sleep in the library's
+// parking lot (see parking_lot.h), which queues them in FIFO order.
+// An all-zero mutex_t is a valid, unlocked default mutex.
+//
+// The lock word and every primitive built on it use the GCC/Clang
+// __atomic builtins, so the library needs GCC or Clang; on Windows,
+// build it with MinGW-w64 or clang-cl.
 // ----------------------------------------
 // Features:
 // - mutex_init:     Initialize a mutex.
 // - mutex_lock:     Acquire the mutex lock (blocks if already locked).
 // - mutex_unlock:   Release the mutex lock.
 // - mutex_destroy:  Clean up mutex resources.
+// - mutex_init_ex:  Initialize a mutex with attributes (e.g. recursive).
+// - mutex_is_locked_by_me: Check whether the calling thread holds the mutex.
+// - mutex_array_create: Allocate and initialize many mutexes at once.
+// - mutex_array_destroy: Release an array from mutex_array_create().
 //
 // Function Signatures:
 // ----------------------------------------
@@ -44,10 +55,180 @@
 //     Example:
 //         mutex_destroy(&m);
 //
+// int mutex_init_ex(mutex_t *m, const mutex_attr_t *attr);
+//     Example:
+//         mutex_attr_t attr;
+//         mutex_attr_init(&attr);
+//         attr.kind = MUTEX_RECURSIVE;
+//         mutex_init_ex(&m, &attr);
+//
+// int mutex_is_locked_by_me(const mutex_t *m);
+//     Example:
+//         assert(mutex_is_locked_by_me(&m));
+//
+// mutex_t *mutex_array_create(size_t n, size_t alignment);
+// mutex_t *mutex_array_create_ex(size_t n, size_t alignment, unsigned threads);
+// mutex_t *mutex_array_at(mutex_t *array, size_t i);
+// void mutex_array_destroy(mutex_t *array);
+//     Example:
+//         mutex_t *stripes = mutex_array_create(1 << 22, 64);
+//         mutex_lock(mutex_array_at(stripes, hash & ((1 << 22) - 1)));
+//         mutex_array_destroy(stripes);
+//
+// Handoff policies (mutex_attr_t::handoff):
+// ----------------------------------------
+// - MUTEX_HANDOFF_BARGING:  Unlock releases the lock and wakes one waiter,
+//                           which competes with newly arriving threads.
+//                           Best throughput; waiters can starve.
+// - MUTEX_HANDOFF_FIFO:     Unlock passes ownership straight to the oldest
+//                           waiter. Strictly fair; every contended unlock
+//                           costs a context switch.
+// - MUTEX_HANDOFF_EVENTUAL: Barging, except that a waiter parked for longer
+//                           than fair_threshold_ns (1 ms by default) is
+//                           handed the lock directly, like Go's starvation
+//                           mode.
+//
+// Adaptive spinning (mutex_attr_t::max_spinners):
+// ----------------------------------------
+// A contended locker spins briefly before parking. By default every
+// waiter may spin. With max_spinners = K, at most K threads spin on the
+// mutex at once and all other waiters park right away; spinners also
+// give up as soon as they find themselves on the CPU the owner last ran
+// on, since the owner then cannot be running.
+//
+// With mutex_attr_t::spin = MUTEX_SPIN_OWNER_RUNNING, waiters spin with
+// pause hints for as long as the owner appears to be on a CPU and park as
+// soon as it does not. The owner publishes its CPU (read through rseq
+// where glibc registers it) and a per-thread running flag, which drops
+// while the owner sleeps in the library or inside
+// mutex_thread_blocking_begin()/mutex_thread_blocking_end(). A waiter
+// also treats the owner as preempted when it, or another spinner, is
+// running on the owner's CPU.
+//
+// Mutex arrays:
+// ----------------------------------------
+// Because an all-zero mutex_t is a valid default mutex, an array of
+// millions of them needs no per-element initialization. The memory is
+// mapped in one piece, backed by huge pages where the system provides
+// them (MAP_HUGETLB, else transparent huge pages through madvise), and
+// comes from the kernel already zeroed, so mutex_array_create() returns
+// without touching it and pages are faulted in on first use.
+// mutex_array_create_ex() instead prefaults the whole array up front,
+// spread over several threads. Elements are `alignment` bytes apart
+// when that exceeds sizeof(mutex_t); index them with mutex_array_at().
+//
+// Debug mode:
+// ----------------------------------------
+// Defining FLUENT_LIBC_MUTEX_DEBUG (CMake: -DMUTEX_DEBUG=ON) enables a
+// lockdep-style checker. Every thread keeps a stack of the locks it holds
+// and every acquisition records "held -> acquired" edges in a global
+// lock-order graph. The checker reports:
+// - lock-order cycles (potential deadlocks), with the recorded chain;
+// - double locks by the owning thread;
+// - unlocks by a thread that does not own the lock;
+// - destruction of a lock that is still held.
+// Each report carries the file/line/function of the offending call and
+// of the conflicting acquisitions. Reports go to the handler installed
+// with mutex_debug_set_handler(), or to stderr by default. Neither this
+// checker nor the watchdog and histograms below add any code or state
+// to builds without their macro.
+//
+// Hold-time watchdog:
+// ----------------------------------------
+// Defining FLUENT_LIBC_MUTEX_WATCHDOG (CMake: -DMUTEX_WATCHDOG=ON) makes
+// every outermost acquisition record when it happened and the return
+// address of its acquisition hook, which lies in the function that called
+// mutex_lock(). mutex_watchdog_start() runs a thread that scans the
+// mutexes registered with mutex_watchdog_register() every interval. It
+// reports each acquisition held longer than the threshold once, with
+// the owner's thread id, the hold time so far and the call site, to a
+// handler or to stderr (symbolized where glibc's backtrace_symbols_fd()
+// can).
+//
+// int mutex_watchdog_register(mutex_t *m, const char *name);
+// int mutex_watchdog_start(uint64_t threshold_ns, uint64_t interval_ns,
+//                          mutex_watchdog_handler_t handler, void *arg);
+// void mutex_watchdog_stop(void);
+//     Example:
+//         mutex_watchdog_register(&table_lock, "table");
+//         mutex_watchdog_start(50000000, 10000000, NULL, NULL); // 50 ms, every 10 ms
+//
+// Wait and hold histograms:
+// ----------------------------------------
+// Defining FLUENT_LIBC_MUTEX_HISTOGRAM (CMake: -DMUTEX_HISTOGRAM=ON) lets
+// mutex_histogram_enable() attach two histogram_t (see histogram.h) to a
+// mutex. One counts how long each outermost acquisition waited, 0 for
+// the uncontended path. The other counts how long the lock was then held.
+// Values are in nanoseconds with MUTEX_HISTOGRAM_DIGITS significant
+// digits. Threads record into their own shards, so instrumented locks
+// share no extra cache lines. mutex_histogram_format() prints both
+// percentile distributions, and mutex_histogram_export() writes them as
+// HdrHistogram log lines (tags <name>.wait and <name>.hold).
+//
+// The watchdog, the histograms and the contention profiler all take
+// their timestamps from cycleclock_now_ns() (see cycleclock.h), which
+// reads the TSC or the AArch64 virtual counter where it can be trusted.
+// mutex_watchdog_start(), mutex_watchdog_register(),
+// mutex_histogram_enable() and mutex_profile_set_rate() calibrate that
+// clock, so no mutex_lock() pays for it.
+//
+// int mutex_histogram_enable(mutex_t *m);
+// size_t mutex_histogram_format(const mutex_t *m, const char *name, double unit_ratio,
+//                               char *buf, size_t size);
+// size_t mutex_histogram_export(const mutex_t *m, const char *name, char *buf, size_t size);
+//     Example:
+//         mutex_histogram_enable(&table_lock);
+//         ...
+//         char text[65536];
+//         mutex_histogram_format(&table_lock, "table", 1000.0, text, sizeof(text)); // in us
+//         mutex_histogram_export(&table_lock, "table", text, sizeof(text));
+//
+// Contention profiler:
+// ----------------------------------------
+// A sampling profiler that is cheap enough to leave on in production,
+// like Go's mutex profile. Once mutex_profile_set_rate(n) is called,
+// each thread samples about one in n of its contended acquisitions. A
+// per-thread countdown picks them, so the uncontended path is
+// untouched, and unsampled contended acquisitions pay one load and a
+// decrement. A sampled acquisition captures up to MUTEX_PROFILE_DEPTH
+// frames of its stack before it waits, then timestamps the wait. The
+// wait is added, scaled by n, to a table keyed by stack. The profile
+// can be written as folded stacks for flame graph tools or in the
+// legacy contention text format that pprof reads (with the memory map
+// on Linux, so pprof can symbolize).
+//
+// void mutex_profile_set_rate(uint32_t rate);
+// size_t mutex_profile_write_folded(char *buf, size_t size);
+// size_t mutex_profile_write_pprof(char *buf, size_t size);
+//     Example:
+//         mutex_profile_set_rate(100); // ~1% of contended acquisitions
+//         ...
+//         size_t len = mutex_profile_write_pprof(NULL, 0);
+//         char *text = malloc(len + 1);
+//         mutex_profile_write_pprof(text, len + 1); // save, then: pprof ./app mutex.prof
+//
+// Trace points:
+// ----------------------------------------
+// mutex_lock() and mutex_unlock() carry SystemTap SDT probes (see
+// sdt.h) under the provider "mutex". Each one is a nop until a tracer
+// attaches, so they are always compiled in unless FLUENT_LIBC_NO_SDT is
+// defined (CMake: -DMUTEX_SDT=OFF). Every probe passes the mutex_t
+// address as arg0:
+// - lock_entry:     mutex_lock() was called.
+// - contend_begin:  the fast path failed; the caller spins or parks.
+// - contend_end:    the contended caller got the lock.
+// - lock_acquired:  mutex_lock() is returning with the lock held.
+// - unlock:         mutex_unlock() is releasing the lock (outermost only).
+// Re-entries of recursive mutexes fire lock_entry only.
+//     Example:
+//         bpftrace -e 'usdt:./app:mutex:contend_begin { @t[tid] = nsecs; }
+//                      usdt:./app:mutex:contend_end /@t[tid]/ {
+//                          @wait_ns = hist(nsecs - @t[tid]); delete(@t[tid]); }'
+//
 // ----------------------------------------
 // Initial revision: 2025-05-26
 // ----------------------------------------
-// Depends on: windows.h (Win32), pthread.h (POSIX)
+// Depends on: parking_lot.h, cycleclock.h, sdt.h, windows.h (Win32), pthread.h (POSIX)
 // ----------------------------------------
 
 #ifdef _WIN32
@@ -57,6 +238,28 @@
 #   endif
 #else
 #   include <pthread.h>
+#   include <sched.h>
+#   ifdef __linux__
+#       include <unistd.h>
+#       include <sys/syscall.h>
+#   endif
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include "sdt.h"
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#   error "mutex.h requires GCC or Clang (the __atomic builtins); on Windows use MinGW-w64 or clang-cl"
+#endif
+
+#ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+#   include "cycleclock.h"
+#endif
+
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+#   if defined(_WIN32) && defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+#       error "FLUENT_LIBC_MUTEX_DEBUG requires the Windows SDK"
+#   endif
 #endif
 
 // ============= FLUENT LIB C++ =============
@@ -64,102 +267,722 @@
 extern "C" {
 #endif
 
+#ifndef FLUENT_LIBC_THREAD_LOCAL
+#   if defined(__cplusplus)
+#       define FLUENT_LIBC_THREAD_LOCAL thread_local
+#   else
+#       define FLUENT_LIBC_THREAD_LOCAL _Thread_local
+#   endif
+#endif
+
 /**
- * @brief Cross-platform mutex abstraction.
+ * @brief Mutex flavours selectable through mutex_attr_t.
+ */
+typedef enum {
+    MUTEX_NORMAL = 0,   /**< Non-recursive; relocking by the owner deadlocks */
+    MUTEX_RECURSIVE     /**< The owner may lock again; unlock once per lock */
+} mutex_kind_t;
+
+/**
+ * @brief What mutex_unlock() does when threads are waiting.
+ */
+typedef enum {
+    MUTEX_HANDOFF_BARGING = 0, /**< Release and wake one waiter; anyone may take the lock */
+    MUTEX_HANDOFF_FIFO,        /**< Hand the lock directly to the oldest waiter */
+    MUTEX_HANDOFF_EVENTUAL     /**< Barge, but hand off to waiters starved past the threshold */
+} mutex_handoff_t;
+
+/**
+ * @brief How a contended locker spins before parking.
+ */
+typedef enum {
+    MUTEX_SPIN_YIELD = 0,     /**< A fixed number of yielding rounds (default) */
+    MUTEX_SPIN_OWNER_RUNNING  /**< Pause-spin while the owner appears to be on a CPU */
+} mutex_spin_t;
+
+/**
+ * @brief Per-thread record published by lock owners (opaque, see mutex.c).
+ */
+typedef struct mutex_thread_state mutex_thread_state_t;
+
+/**
+ * @brief Default starvation threshold of MUTEX_HANDOFF_EVENTUAL (1 ms).
+ */
+#define MUTEX_DEFAULT_FAIR_THRESHOLD_NS 1000000ULL
+
+/**
+ * @brief Initialization options for mutex_init_ex().
  *
- * This struct provides a platform-independent mutex implementation,
- * using CRITICAL_SECTION on Windows and pthread_mutex_t on POSIX systems.
+ * Always start from mutex_attr_init() so that fields added later
+ * keep their defaults.
  */
 typedef struct {
-#ifdef _WIN32
-#   ifndef FLUENT_LIBC_NO_WINDOWS_SDK
-    CRITICAL_SECTION cs;   /**< Windows critical section */
-    // If the Windows SDK is not included
-    // we can't use CRITICAL_SECTION directly.
+    mutex_kind_t kind;          /**< Mutex flavour, MUTEX_NORMAL by default */
+    mutex_handoff_t handoff;    /**< Unlock policy, MUTEX_HANDOFF_BARGING by default */
+    uint64_t fair_threshold_ns; /**< Starvation threshold for MUTEX_HANDOFF_EVENTUAL */
+    unsigned int max_spinners;  /**< Concurrent spinners allowed, 0 (default) = unbounded */
+    mutex_spin_t spin;          /**< Spin strategy, MUTEX_SPIN_YIELD by default */
+} mutex_attr_t;
+
+/**
+ * @brief Lock word bits of mutex_t::state.
+ */
+#define MUTEX_STATE_LOCKED 1u   /**< The mutex is held */
+#define MUTEX_STATE_PARKED 2u   /**< Threads may be parked on the mutex */
+
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+/**
+ * @brief Maximum number of locks a single thread can hold while still
+ * being tracked by the lock-order checker.
+ */
+#   ifndef MUTEX_DEBUG_MAX_HELD
+#       define MUTEX_DEBUG_MAX_HELD 48
 #   endif
-#else
-    pthread_mutex_t mutex; /**< POSIX mutex */
+
+/**
+ * @brief Source location of a lock operation (debug builds only).
+ */
+typedef struct {
+    const char *file;     /**< Source file of the call */
+    int line;             /**< Source line of the call */
+    const char *func;     /**< Enclosing function of the call */
+} mutex_site_t;
+#endif
+
+/**
+ * @brief Cross-platform mutex abstraction.
+ *
+ * This struct provides a platform-independent mutex implementation
+ * built on a lock word and the library's parking lot.
+ */
+typedef struct {
+    uint32_t state;             /**< Lock word, see MUTEX_STATE_* */
+    mutex_kind_t kind;          /**< Flavour chosen at initialization */
+    mutex_handoff_t handoff;    /**< Unlock policy chosen at initialization */
+    unsigned int recursion;     /**< Re-acquisitions by the owner (recursive mutexes) */
+    uintptr_t owner;            /**< Thread id of the holder, 0 when unlocked */
+    uint64_t fair_threshold_ns; /**< Starvation threshold (MUTEX_HANDOFF_EVENTUAL) */
+    uint32_t max_spinners;      /**< Spinner bound, 0 = unbounded */
+    uint32_t spinners;          /**< Threads currently spinning on the lock word */
+    int32_t owner_cpu;          /**< CPU the owner acquired on (owner hints only), -1 if unknown */
+    mutex_spin_t spin;          /**< Spin strategy chosen at initialization */
+    int owner_hints;            /**< Owners publish owner_cpu/owner_state */
+    mutex_thread_state_t *owner_state; /**< Running-state record of the owner (owner hints only) */
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+    unsigned long long debug_id; /**< Node in the lock-order graph */
+    void *debug_owner;           /**< Checker record of the holding thread, or NULL */
+    mutex_site_t debug_site;     /**< Where the current owner acquired the lock */
+#endif
+#ifdef FLUENT_LIBC_MUTEX_WATCHDOG
+    uint64_t watch_since_ns;     /**< cycleclock_now_ns() at the outermost acquisition, 0 when unlocked */
+    void *watch_site;            /**< Return address of the acquisition hook */
+#endif
+#ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+    struct histogram *wait_hist; /**< Wait times, or NULL when not instrumented */
+    struct histogram *hold_hist; /**< Hold times, or NULL when not instrumented */
+    uint64_t hist_since_ns;      /**< When the holder acquired it, 0 if not timed */
 #endif
 } mutex_t;
 
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
 /**
- * @brief Initializes the mutex.
+ * @brief Kind of problem found by the lock-order checker.
+ */
+typedef enum {
+    MUTEX_DEBUG_ORDER_CYCLE,      /**< Acquisition closes a cycle in the lock-order graph */
+    MUTEX_DEBUG_DOUBLE_LOCK,      /**< Owner tried to lock the mutex again */
+    MUTEX_DEBUG_UNLOCK_NOT_OWNER, /**< Unlock by a thread that does not hold the mutex */
+    MUTEX_DEBUG_DESTROY_LOCKED    /**< Destroy while the mutex is still held */
+} mutex_debug_kind_t;
+
+/**
+ * @brief One lock held by a thread, as tracked by the checker.
+ */
+typedef struct {
+    const mutex_t *lock;  /**< The held mutex */
+    mutex_site_t site;    /**< Where it was acquired */
+} mutex_debug_held_t;
+
+/**
+ * @brief One "from held, to acquired" edge of the lock-order graph.
+ */
+typedef struct {
+    const mutex_t *from;    /**< Lock that was held */
+    const mutex_t *to;      /**< Lock that was acquired while holding it */
+    mutex_site_t from_site; /**< Where `from` had been acquired */
+    mutex_site_t to_site;   /**< Where `to` was acquired */
+} mutex_debug_edge_t;
+
+/**
+ * @brief Problem report passed to the debug handler.
  *
- * @param m Pointer to the mutex_t structure to initialize.
- * @return 0 on success, or a non-zero error code on failure (POSIX only).
+ * All pointers are only valid for the duration of the handler call.
  */
-static inline int mutex_init(mutex_t *m) {
+typedef struct {
+    mutex_debug_kind_t kind;          /**< What went wrong */
+    const mutex_t *lock;              /**< Mutex the offending operation was applied to */
+    mutex_site_t site;                /**< Site of the offending operation */
+    mutex_site_t owner_site;          /**< Acquisition site of the current owner, if any */
+    const mutex_debug_edge_t *chain;  /**< Cycle only: recorded path from `lock` back to a held lock */
+    size_t chain_len;                 /**< Number of edges in `chain` */
+    const mutex_debug_held_t *held;   /**< Locks held by the reporting thread */
+    size_t held_count;                /**< Number of entries in `held` */
+} mutex_debug_report_t;
+
+/**
+ * @brief Callback receiving checker reports.
+ */
+typedef void (*mutex_debug_handler_t)(const mutex_debug_report_t *report);
+
+/**
+ * @brief Installs the report handler, or restores the default when NULL.
+ *
+ * The default handler prints the report to stderr and aborts on double
+ * locks, which would otherwise self-deadlock.
+ */
+void mutex_debug_set_handler(mutex_debug_handler_t handler);
+
+// Checker hooks, called by the debug wrappers below.
+void mutex_debug_on_init(mutex_t *m);
+void mutex_debug_on_lock(mutex_t *m, mutex_site_t site);
+void mutex_debug_on_acquired(mutex_t *m, mutex_site_t site);
+void mutex_debug_on_unlock(mutex_t *m, mutex_site_t site);
+void mutex_debug_on_destroy(mutex_t *m, mutex_site_t site);
+void mutex_debug_on_array_init(mutex_t *array, size_t n);
+void mutex_debug_array_destroy(mutex_t *array, const char *file, int line, const char *func);
+#endif
+
+#ifdef FLUENT_LIBC_MUTEX_WATCHDOG
+/**
+ * @brief A registered mutex held past the watchdog threshold.
+ *
+ * Pointers are only valid for the duration of the handler call.
+ */
+typedef struct {
+    const mutex_t *lock;  /**< The mutex */
+    const char *name;     /**< Name given at registration, or NULL */
+    uintptr_t owner;      /**< mutex_thread_id() of the holder */
+    uint64_t held_ns;     /**< How long it has been held so far */
+    void *site;           /**< Code address in the function that acquired it */
+} mutex_watchdog_report_t;
+
+/**
+ * @brief Callback receiving watchdog reports, on the watchdog thread.
+ */
+typedef void (*mutex_watchdog_handler_t)(const mutex_watchdog_report_t *report, void *arg);
+
+/**
+ * @brief Adds a mutex to the set the watchdog scans.
+ *
+ * @param m The mutex; must stay valid until unregistered.
+ * @param name Label for reports, or NULL; must outlive the registration.
+ * @return 0 on success, ENOMEM on allocation failure.
+ */
+int mutex_watchdog_register(mutex_t *m, const char *name);
+
+/**
+ * @brief Removes a mutex from the watched set.
+ */
+void mutex_watchdog_unregister(mutex_t *m);
+
+/**
+ * @brief Starts the watchdog thread.
+ *
+ * @param threshold_ns Hold time that triggers a report.
+ * @param interval_ns Time between scans.
+ * @param handler Receives reports, or NULL to log to stderr.
+ * @param arg Passed to the handler.
+ * @return 0 on success, EINVAL for a zero interval, EBUSY if already
+ * running, EAGAIN if the thread could not be created.
+ */
+int mutex_watchdog_start(uint64_t threshold_ns, uint64_t interval_ns,
+                         mutex_watchdog_handler_t handler, void *arg);
+
+/**
+ * @brief Stops the watchdog thread and waits for it to exit.
+ */
+void mutex_watchdog_stop(void);
+
+/**
+ * @brief Records the acquisition time and site. Called by mutex_lock().
+ */
+void mutex_watchdog_on_acquired(mutex_t *m);
+#endif
+
+#ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+/**
+ * @brief Highest wait or hold time told apart, in nanoseconds; longer
+ * ones are counted as this value.
+ */
+#   ifndef MUTEX_HISTOGRAM_MAX_NS
+#       define MUTEX_HISTOGRAM_MAX_NS 60000000000ULL
+#   endif
+
+/**
+ * @brief Significant decimal digits of the wait and hold histograms.
+ */
+#   ifndef MUTEX_HISTOGRAM_DIGITS
+#       define MUTEX_HISTOGRAM_DIGITS 2
+#   endif
+
+/**
+ * @brief Starts recording wait and hold times of the mutex.
+ *
+ * May be called while the mutex is in use; an acquisition in progress
+ * is not timed.
+ *
+ * @param m The mutex.
+ * @return 0 on success (also if already enabled), ENOMEM on allocation failure.
+ */
+int mutex_histogram_enable(mutex_t *m);
+
+/**
+ * @brief Stops recording and releases the histograms. No thread may
+ * use the mutex meanwhile.
+ */
+void mutex_histogram_disable(mutex_t *m);
+
+/**
+ * @brief Writes the wait and hold percentile distributions, each in
+ * HdrHistogram's text format under a "# <name> wait" or
+ * "# <name> hold" line.
+ *
+ * @param m The mutex.
+ * @param name Label for the headings.
+ * @param unit_ratio Divisor for printed values (1000 prints microseconds).
+ * @param buf Destination, or NULL to measure.
+ * @param size Size of buf; output is truncated and NUL-terminated.
+ * @return Length of the full text like snprintf, 0 if not enabled or
+ * out of memory.
+ */
+size_t mutex_histogram_format(const mutex_t *m, const char *name, double unit_ratio,
+                              char *buf, size_t size);
+
+/**
+ * @brief Writes both histograms as HdrHistogram log lines
+ * ("Tag=<name>.wait,0.000,<seconds enabled>,<max ms>,<base64>").
+ *
+ * @param m The mutex.
+ * @param name Tag prefix; must not contain commas or spaces.
+ * @param buf Destination, or NULL to measure.
+ * @param size Size of buf; output is truncated and NUL-terminated.
+ * @return Length of the full text like snprintf, 0 if not enabled or
+ * out of memory.
+ */
+size_t mutex_histogram_export(const mutex_t *m, const char *name, char *buf, size_t size);
+
+/**
+ * @brief Histogram hooks, called by mutex_lock() and mutex_unlock().
+ */
+void mutex_histogram_on_acquired(mutex_t *m, uint64_t wait_start_ns);
+void mutex_histogram_on_release(mutex_t *m);
+#endif
+
+/**
+ * @brief Frames kept per contention profiler sample.
+ */
+#ifndef MUTEX_PROFILE_DEPTH
+#   define MUTEX_PROFILE_DEPTH 16
+#endif
+
+/**
+ * @brief Sets how many contended acquisitions a thread makes per
+ * profiler sample, on average. 0 (the default) disables sampling.
+ */
+void mutex_profile_set_rate(uint32_t rate);
+
+/**
+ * @brief Returns the rate set with mutex_profile_set_rate().
+ */
+uint32_t mutex_profile_rate(void);
+
+/**
+ * @brief Discards every sample collected so far.
+ */
+void mutex_profile_reset(void);
+
+/**
+ * @brief Writes the profile as folded stacks ("outer;inner;leaf <ns>"),
+ * one line per distinct stack, weighted by estimated wait time.
+ *
+ * Frames are named with backtrace_symbols() where glibc provides it
+ * (link with -rdynamic for full names), else printed as addresses.
+ *
+ * @param buf Destination, or NULL to measure.
+ * @param size Size of buf; output is truncated and NUL-terminated.
+ * @return Length of the full text like snprintf, 0 on allocation failure.
+ */
+size_t mutex_profile_write_folded(char *buf, size_t size);
+
+/**
+ * @brief Writes the profile in pprof's legacy contention format, with
+ * estimated counts and wait nanoseconds per stack.
+ *
+ * @param buf Destination, or NULL to measure.
+ * @param size Size of buf; output is truncated and NUL-terminated.
+ * @return Length of the full text like snprintf, 0 on allocation failure.
+ */
+size_t mutex_profile_write_pprof(char *buf, size_t size);
+
+/**
+ * @brief Contended slow paths, implemented in mutex.c.
+ */
+void mutex_lock_slow(mutex_t *m);
+void mutex_unlock_slow(mutex_t *m);
+
+/**
+ * @brief Returns the CPU the caller is running on, or -1 if unknown.
+ *
+ * Reads the rseq area when glibc has registered one, which costs a
+ * single load. Implemented in mutex.c.
+ */
+int mutex_current_cpu(void);
+
+/**
+ * @brief Records the caller's CPU and running-state record as the owner's.
+ *
+ * Called after acquisition on mutexes that spin based on the owner.
+ */
+void mutex_publish_owner(mutex_t *m);
+
+/**
+ * @brief Marks the calling thread as off-CPU until the matching end call.
+ *
+ * Wrap blocking calls (I/O, sleeps) made while holding a mutex so that
+ * MUTEX_SPIN_OWNER_RUNNING waiters park instead of spinning. The library
+ * does this itself whenever a thread sleeps in the parking lot.
+ */
+void mutex_thread_blocking_begin(void);
+
+/**
+ * @brief Marks the calling thread as running again.
+ */
+void mutex_thread_blocking_end(void);
+
+/**
+ * @brief Tells the CPU that the caller is busy-waiting.
+ *
+ * Emits PAUSE on x86 and YIELD on ARM, which saves power and frees
+ * pipeline resources for a sibling hyper-thread.
+ */
+static inline void mutex_cpu_relax(void) {
+#   if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#   elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield" ::: "memory");
+#   else
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+#   endif
+}
+
+/**
+ * @brief Offers the rest of the caller's time slice to another thread.
+ */
+static inline void mutex_thread_yield(void) {
+#   ifdef _WIN32
+#       ifndef FLUENT_LIBC_NO_WINDOWS_SDK
+            SwitchToThread();
+#       else
+            mutex_cpu_relax();
+#       endif
+#   else
+    sched_yield();
+#   endif
+}
+
+/**
+ * @brief Returns a non-zero identifier of the calling thread.
+ *
+ * This is the kernel TID on Linux and Windows. The value is cached in
+ * thread-local storage, so the call is a single TLS load after the first use.
+ */
+static inline uintptr_t mutex_thread_id(void) {
+    static FLUENT_LIBC_THREAD_LOCAL uintptr_t tid = 0;
+    if (tid == 0) {
 #   ifdef _WIN32
 #       ifndef FLUENT_LIBC_NO_WINDOWS_SDK
-            InitializeCriticalSection(&m->cs);
-            return 0;
-#       else // FLUENT_LIBC_NO_WINDOWS_SDK
-            // If the Windows SDK is not included, we can't use CRITICAL_SECTION.
-            // Return an error code or handle it as needed.
-            return -1; // Indicating failure to initialize
-#       endif // FLUENT_LIBC_NO_WINDOWS_SDK
+            tid = (uintptr_t) GetCurrentThreadId();
+#       else
+            // Without the SDK, the address of a thread-local is unique per live thread
+            tid = (uintptr_t) &tid;
+#       endif
+#   elif defined(__linux__)
+        tid = (uintptr_t) syscall(SYS_gettid);
 #   else
-    return pthread_mutex_init(&m->mutex, NULL);
+        tid = (uintptr_t) pthread_self();
+#   endif
+    }
+    return tid;
+}
+
+/**
+ * @brief Fills the attributes with their defaults.
+ *
+ * @param attr Pointer to the attributes to initialize.
+ */
+static inline void mutex_attr_init(mutex_attr_t *attr) {
+    attr->kind = MUTEX_NORMAL;
+    attr->handoff = MUTEX_HANDOFF_BARGING;
+    attr->fair_threshold_ns = MUTEX_DEFAULT_FAIR_THRESHOLD_NS;
+    attr->max_spinners = 0;
+    attr->spin = MUTEX_SPIN_YIELD;
+}
+
+/**
+ * @brief Initializes the mutex with the given attributes.
+ *
+ * @param m Pointer to the mutex_t structure to initialize.
+ * @param attr Attributes, or NULL for the defaults.
+ * @return 0 on success.
+ */
+static inline int mutex_init_ex(mutex_t *m, const mutex_attr_t *attr) {
+    mutex_attr_t defaults;
+    if (!attr) {
+        mutex_attr_init(&defaults);
+        attr = &defaults;
+    }
+
+    m->state = 0;
+    m->kind = attr->kind;
+    m->handoff = attr->handoff;
+    m->recursion = 0;
+    m->owner = 0;
+    m->fair_threshold_ns = attr->fair_threshold_ns;
+    m->max_spinners = attr->max_spinners;
+    m->spinners = 0;
+    m->owner_cpu = -1;
+    m->spin = attr->spin;
+    m->owner_hints = attr->max_spinners != 0 || attr->spin == MUTEX_SPIN_OWNER_RUNNING;
+    m->owner_state = NULL;
+#   ifdef FLUENT_LIBC_MUTEX_WATCHDOG
+        m->watch_since_ns = 0;
+        m->watch_site = NULL;
 #   endif
+#   ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+        m->wait_hist = NULL;
+        m->hold_hist = NULL;
+        m->hist_since_ns = 0;
+#   endif
+#   ifdef FLUENT_LIBC_MUTEX_DEBUG
+        mutex_debug_on_init(m);
+#   endif
+    return 0;
+}
+
+/**
+ * @brief Initializes the mutex.
+ *
+ * @param m Pointer to the mutex_t structure to initialize.
+ * @return 0 on success.
+ */
+static inline int mutex_init(mutex_t *m) {
+    return mutex_init_ex(m, NULL);
+}
+
+/**
+ * @brief Bookkeeping stored right before the first element of a mutex array.
+ */
+typedef struct {
+    void *base;     /**< Start of the allocation */
+    size_t bytes;   /**< Size of the allocation */
+    size_t count;   /**< Number of mutexes */
+    size_t stride;  /**< Distance between consecutive mutexes */
+    int mapped;     /**< 1 if base came from the OS mapping call, 0 if from malloc */
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+    unsigned long long debug_first;  /**< Lock-order ids handed out at creation, */
+    unsigned long long debug_last;   /**< first to last */
+#endif
+} mutex_array_header_t;
+
+/**
+ * @brief Allocates `n` unlocked default mutexes in one zero-filled block.
+ *
+ * @param n Number of mutexes.
+ * @param alignment Alignment of each mutex (a power of two), or 0 for
+ * the natural one. Values above sizeof(mutex_t) pad the elements apart,
+ * e.g. 64 to keep each on its own cache line.
+ * @return The first mutex, or NULL (errno set to EINVAL or ENOMEM).
+ */
+mutex_t *mutex_array_create(size_t n, size_t alignment);
+
+/**
+ * @brief Like mutex_array_create(), but prefaults the memory with
+ * `threads` threads (0 = leave it to first use, like mutex_array_create()).
+ */
+mutex_t *mutex_array_create_ex(size_t n, size_t alignment, unsigned threads);
+
+/**
+ * @brief Releases a mutex array. No element may be locked or in use.
+ *
+ * @param array Value returned by mutex_array_create(), or NULL.
+ */
+void mutex_array_destroy(mutex_t *array);
+
+/**
+ * @brief Returns element `i` of a mutex array.
+ *
+ * @param array Value returned by mutex_array_create().
+ * @param i Index, below the array's count.
+ * @return Pointer to the mutex.
+ */
+static inline mutex_t *mutex_array_at(mutex_t *array, const size_t i) {
+    const mutex_array_header_t *h = (const mutex_array_header_t *) array - 1;
+    return (mutex_t *) ((char *) array + i * h->stride);
+}
+
+/**
+ * @brief Checks whether the calling thread holds the mutex.
+ *
+ * Meant for assertions; the answer is exact for the calling thread.
+ *
+ * @param m Pointer to the mutex_t structure to inspect.
+ * @return 1 if the caller owns the mutex, 0 otherwise.
+ */
+static inline int mutex_is_locked_by_me(const mutex_t *m) {
+    return __atomic_load_n(&m->owner, __ATOMIC_RELAXED) == mutex_thread_id();
+}
+
+/**
+ * @brief Returns the thread id of the current holder.
+ *
+ * The value is a snapshot and may be stale by the time it is used.
+ *
+ * @param m Pointer to the mutex_t structure to inspect.
+ * @return The owner's mutex_thread_id(), or 0 if the mutex is unlocked.
+ */
+static inline uintptr_t mutex_owner(const mutex_t *m) {
+    return __atomic_load_n(&m->owner, __ATOMIC_RELAXED);
 }
 
 /**
  * @brief Locks the mutex.
  *
  * Blocks if the mutex is already locked by another thread.
+ * A recursive mutex already held by the caller is re-entered instead.
  *
  * @param m Pointer to the mutex_t structure to lock.
  */
 static inline void mutex_lock(mutex_t *m) {
-#   ifdef _WIN32
-#       ifndef FLUENT_LIBC_NO_WINDOWS_SDK
-            EnterCriticalSection(&m->cs);
-#       else // FLUENT_LIBC_NO_WINDOWS_SDK
-            // If the Windows SDK is not included, we can't use CRITICAL_SECTION.
+    FLUENT_SDT_PROBE1(mutex, lock_entry, m);
+    const uintptr_t self = mutex_thread_id();
+    // Only the owner itself can have stored its own id, so a relaxed load suffices
+    if (m->kind == MUTEX_RECURSIVE && __atomic_load_n(&m->owner, __ATOMIC_RELAXED) == self) {
+        m->recursion++;
+        return;
+    }
+
+#   ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+        uint64_t wait_start = 0;
+#   endif
+    uint32_t expected = 0;
+    if (!__atomic_compare_exchange_n(&m->state, &expected, MUTEX_STATE_LOCKED, 0,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+#       ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+            if (__atomic_load_n(&m->wait_hist, __ATOMIC_RELAXED)) {
+                wait_start = cycleclock_now_ns();
+            }
 #       endif
-#   else
-    pthread_mutex_lock(&m->mutex);
+        mutex_lock_slow(m);
+    }
+    __atomic_store_n(&m->owner, self, __ATOMIC_RELAXED);
+    if (m->owner_hints) {
+        // Lets spinners notice when the owner cannot be running
+        mutex_publish_owner(m);
+    }
+#   ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+        if (__atomic_load_n(&m->wait_hist, __ATOMIC_RELAXED)) {
+            mutex_histogram_on_acquired(m, wait_start);
+        }
+#   endif
+#   ifdef FLUENT_LIBC_MUTEX_WATCHDOG
+        mutex_watchdog_on_acquired(m);
 #   endif
+    FLUENT_SDT_PROBE1(mutex, lock_acquired, m);
 }
 
 /**
  * @brief Unlocks the mutex.
  *
- * Releases the lock held on the mutex.
+ * Releases the lock held on the mutex. A recursive mutex is released
+ * once every nested mutex_lock() has been matched by an unlock.
+ * If threads are waiting, the mutex's handoff policy decides who gets it.
  *
  * @param m Pointer to the mutex_t structure to unlock.
  */
 static inline void mutex_unlock(mutex_t *m) {
-#   ifdef _WIN32
-#       ifndef FLUENT_LIBC_NO_WINDOWS_SDK
-            LeaveCriticalSection(&m->cs);
-#       else
-            // If the Windows SDK is not included, we can't use CRITICAL_SECTION.
-#       endif
-#   else
-    pthread_mutex_unlock(&m->mutex);
+    if (m->recursion > 0) {
+        m->recursion--;
+        return;
+    }
+
+    FLUENT_SDT_PROBE1(mutex, unlock, m);
+#   ifdef FLUENT_LIBC_MUTEX_WATCHDOG
+        __atomic_store_n(&m->watch_since_ns, 0, __ATOMIC_RELAXED);
+#   endif
+#   ifdef FLUENT_LIBC_MUTEX_HISTOGRAM
+        if (m->hist_since_ns) {
+            mutex_histogram_on_release(m);
+        }
 #   endif
+    __atomic_store_n(&m->owner, 0, __ATOMIC_RELAXED);
+    uint32_t expected = MUTEX_STATE_LOCKED;
+    if (!__atomic_compare_exchange_n(&m->state, &expected, 0, 0,
+                                     __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        mutex_unlock_slow(m);
+    }
 }
 
 /**
  * @brief Destroys the mutex.
  *
- * Cleans up resources associated with the mutex.
+ * Cleans up resources associated with the mutex. The lock word holds no
+ * OS resources, so this only matters for debug builds.
  *
  * @param m Pointer to the mutex_t structure to destroy.
  */
 static inline void mutex_destroy(mutex_t *m) {
-#   ifdef _WIN32
-#       ifndef FLUENT_LIBC_NO_WINDOWS_SDK
-            DeleteCriticalSection(&m->cs);
-#       else // FLUENT_LIBC_NO_WINDOWS_SDK
-            // If the Windows SDK is not included, we can't use CRITICAL_SECTION.
-#       endif
-#   else
-    pthread_mutex_destroy(&m->mutex);
-#   endif
+    (void) m;
 }
 
+#ifdef FLUENT_LIBC_MUTEX_DEBUG
+// In debug builds the public lock operations are routed through these
+// wrappers so that every call reports its source location.
+
+static inline void mutex_debug_lock(mutex_t *m, const char *file, int line, const char *func) {
+    const mutex_site_t site = { file, line, func };
+    if (m->kind == MUTEX_RECURSIVE && mutex_is_locked_by_me(m)) {
+        mutex_lock(m); // Re-entry does not change the held set
+        return;
+    }
+
+    mutex_debug_on_lock(m, site);
+    mutex_lock(m);
+    mutex_debug_on_acquired(m, site);
+}
+
+static inline void mutex_debug_unlock(mutex_t *m, const char *file, int line, const char *func) {
+    const mutex_site_t site = { file, line, func };
+    if (m->recursion > 0 && mutex_is_locked_by_me(m)) {
+        mutex_unlock(m);
+        return;
+    }
+
+    mutex_debug_on_unlock(m, site);
+    mutex_unlock(m);
+}
+
+static inline void mutex_debug_destroy(mutex_t *m, const char *file, int line, const char *func) {
+    const mutex_site_t site = { file, line, func };
+    mutex_debug_on_destroy(m, site);
+    mutex_destroy(m);
+}
+
+#   define mutex_lock(m)    mutex_debug_lock((m), __FILE__, __LINE__, __func__)
+#   define mutex_unlock(m)  mutex_debug_unlock((m), __FILE__, __LINE__, __func__)
+#   define mutex_destroy(m) mutex_debug_destroy((m), __FILE__, __LINE__, __func__)
+#   define mutex_array_destroy(a) mutex_debug_array_destroy((a), __FILE__, __LINE__, __func__)
+#endif
+
 // ============= FLUENT LIB C++ =============
 #if defined(__cplusplus)
 }
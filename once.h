@@ -0,0 +1,145 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_ONCE_LIBRARY_H
+#define FLUENT_LIBC_ONCE_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// once_t API
+// ----------------------------------------
+// One-time initialization. After initialization has finished, checking
+// it costs a single acquire load and takes no lock, so it can sit on
+// hot lookup paths. The first callers are serialized: one runs the
+// initializer while the others sleep on the once word (futex on Linux,
+// the parking lot elsewhere) until it finishes.
+//
+// The functions are prefixed once_ rather than named after C11's
+// call_once so that both can be used in one translation unit.
+// ----------------------------------------
+// Features:
+// - once_call:     Run an initializer exactly once.
+// - once_is_done:  Check whether the initializer has completed.
+//
+// Function Signatures:
+// ----------------------------------------
+// void once_call(once_t *o, void (*fn)(void *), void *arg);
+//     Example:
+//         static once_t table_once = ONCE_INIT;
+//         once_call(&table_once, build_table, &table);
+//
+// int once_is_done(const once_t *o);
+//     Example:
+//         assert(once_is_done(&table_once));
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: wait.h
+// ----------------------------------------
+
+#include "wait.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief States of once_t::state.
+ */
+#define ONCE_STATE_NEW      0u  /**< Initializer not started */
+#define ONCE_STATE_RUNNING  1u  /**< Initializer running, nobody waiting */
+#define ONCE_STATE_WAITING  2u  /**< Initializer running, threads asleep */
+#define ONCE_STATE_DONE     3u  /**< Initializer finished */
+
+/**
+ * @brief One-time initialization flag.
+ *
+ * Must be statically initialized with ONCE_INIT (or zero-filled).
+ */
+typedef struct {
+    uint32_t state;  /**< One of ONCE_STATE_* */
+} once_t;
+
+#define ONCE_INIT { ONCE_STATE_NEW }
+
+/**
+ * @brief Runs or waits for the initializer (contended first-time path).
+ */
+static inline void once_call_slow(once_t *o, void (*fn)(void *), void *arg) {
+    for (;;) {
+        uint32_t state = __atomic_load_n(&o->state, __ATOMIC_ACQUIRE);
+
+        switch (state) {
+            case ONCE_STATE_DONE:
+                return;
+
+            case ONCE_STATE_NEW:
+                if (__atomic_compare_exchange_n(&o->state, &state, ONCE_STATE_RUNNING, 0,
+                                                __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+                    fn(arg);
+                    if (__atomic_exchange_n(&o->state, ONCE_STATE_DONE, __ATOMIC_RELEASE) == ONCE_STATE_WAITING) {
+                        wake_all(&o->state);
+                    }
+                    return;
+                }
+                break;
+
+            case ONCE_STATE_RUNNING:
+                // Tell the initializer to wake us, then sleep
+                if (!__atomic_compare_exchange_n(&o->state, &state, ONCE_STATE_WAITING, 0,
+                                                 __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                    break;
+                }
+                wait_on_address(&o->state, ONCE_STATE_WAITING, PARKING_LOT_FOREVER);
+                break;
+
+            default:
+                wait_on_address(&o->state, ONCE_STATE_WAITING, PARKING_LOT_FOREVER);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Runs `fn(arg)` exactly once across all callers sharing `o`.
+ *
+ * Callers that arrive while the initializer runs block until it returns;
+ * every caller returns only after the initializer's effects are visible.
+ * The initializer must not call once_call() on the same flag.
+ *
+ * @param o Pointer to the once_t flag.
+ * @param fn Initializer.
+ * @param arg Argument passed to the initializer.
+ */
+static inline void once_call(once_t *o, void (*fn)(void *), void *arg) {
+    // Post-initialization fast path: one acquire load, no lock
+    if (__atomic_load_n(&o->state, __ATOMIC_ACQUIRE) == ONCE_STATE_DONE) {
+        return;
+    }
+    once_call_slow(o, fn, arg);
+}
+
+/**
+ * @brief Checks whether the initializer has completed.
+ *
+ * @param o Pointer to the once_t flag.
+ * @return 1 if the initializer finished, 0 otherwise.
+ */
+static inline int once_is_done(const once_t *o) {
+    return __atomic_load_n(&o->state, __ATOMIC_ACQUIRE) == ONCE_STATE_DONE;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_ONCE_LIBRARY_H
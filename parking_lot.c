@@ -0,0 +1,478 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include "parking_lot.h"
+#include "mutex.h"
+
+#if defined(__linux__)
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#   include <linux/futex.h>
+#elif !defined(_WIN32)
+#   include <pthread.h>
+#   include <sched.h>
+#endif
+
+/**
+ * @brief Number of hash buckets; a power of two.
+ */
+#define PARKING_LOT_BUCKETS 1024
+
+/**
+ * @brief Assumed cache line size, used to keep buckets apart.
+ */
+#define PARKING_LOT_CACHE_LINE 64
+
+// ============= PLATFORM WAIT =============
+#if defined(__linux__)
+static void futex_wait(const uint32_t *word, const uint32_t expected, const uint64_t timeout_ns) {
+    struct timespec ts;
+    struct timespec *tsp = NULL;
+    if (timeout_ns != PARKING_LOT_FOREVER) {
+        ts.tv_sec = (time_t) (timeout_ns / 1000000000ULL);
+        ts.tv_nsec = (long) (timeout_ns % 1000000000ULL);
+        tsp = &ts;
+    }
+    syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, tsp, NULL, 0);
+}
+
+static void futex_wake(const uint32_t *word, const int count) {
+    syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/**
+ * @brief Bucket lock: the classic three-state futex mutex
+ * (0 = free, 1 = locked, 2 = locked with sleepers).
+ */
+typedef uint32_t bucket_lock_t;
+
+static void bucket_lock(bucket_lock_t *l) {
+    uint32_t c = 0;
+    if (__atomic_compare_exchange_n(l, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    if (c != 2) {
+        c = __atomic_exchange_n(l, 2, __ATOMIC_ACQUIRE);
+    }
+    while (c != 0) {
+        futex_wait(l, 2, PARKING_LOT_FOREVER);
+        c = __atomic_exchange_n(l, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+static void bucket_unlock(bucket_lock_t *l) {
+    if (__atomic_exchange_n(l, 0, __ATOMIC_RELEASE) == 2) {
+        futex_wake(l, 1);
+    }
+}
+
+/**
+ * @brief One-shot wake-up signal owned by a parked thread.
+ */
+typedef struct {
+    uint32_t signaled;
+} parker_t;
+
+static void parker_init(parker_t *p) {
+    p->signaled = 0;
+}
+
+static int parker_wait(parker_t *p, const uint64_t deadline_ns) {
+    while (__atomic_load_n(&p->signaled, __ATOMIC_ACQUIRE) == 0) {
+        uint64_t timeout = PARKING_LOT_FOREVER;
+        if (deadline_ns != PARKING_LOT_FOREVER) {
+            const uint64_t now = parking_lot_now_ns();
+            if (now >= deadline_ns) {
+                return 0;
+            }
+            timeout = deadline_ns - now;
+        }
+        futex_wait(&p->signaled, 0, timeout);
+    }
+    return 1;
+}
+
+static void parker_signal(parker_t *p) {
+    // The parker may return as soon as it sees the store; waking a stale
+    // address afterwards is harmless for private futexes.
+    __atomic_store_n(&p->signaled, 1, __ATOMIC_RELEASE);
+    futex_wake(&p->signaled, 1);
+}
+
+static void parker_destroy(parker_t *p) {
+    (void) p;
+}
+#elif defined(_WIN32) && !defined(FLUENT_LIBC_NO_WINDOWS_SDK)
+typedef SRWLOCK bucket_lock_t;
+
+static void bucket_lock(bucket_lock_t *l) {
+    AcquireSRWLockExclusive(l);
+}
+
+static void bucket_unlock(bucket_lock_t *l) {
+    ReleaseSRWLockExclusive(l);
+}
+
+typedef struct {
+    SRWLOCK lock;
+    CONDITION_VARIABLE cond;
+    int signaled;
+} parker_t;
+
+static void parker_init(parker_t *p) {
+    InitializeSRWLock(&p->lock);
+    InitializeConditionVariable(&p->cond);
+    p->signaled = 0;
+}
+
+static int parker_wait(parker_t *p, const uint64_t deadline_ns) {
+    int signaled;
+    AcquireSRWLockExclusive(&p->lock);
+    while (!p->signaled) {
+        DWORD ms = INFINITE;
+        if (deadline_ns != PARKING_LOT_FOREVER) {
+            const uint64_t now = parking_lot_now_ns();
+            if (now >= deadline_ns) {
+                break;
+            }
+            ms = (DWORD) ((deadline_ns - now + 999999) / 1000000);
+        }
+        SleepConditionVariableSRW(&p->cond, &p->lock, ms, 0);
+    }
+    signaled = p->signaled;
+    ReleaseSRWLockExclusive(&p->lock);
+    return signaled;
+}
+
+static void parker_signal(parker_t *p) {
+    AcquireSRWLockExclusive(&p->lock);
+    p->signaled = 1;
+    WakeConditionVariable(&p->cond);
+    ReleaseSRWLockExclusive(&p->lock);
+}
+
+static void parker_destroy(parker_t *p) {
+    (void) p;
+}
+#elif defined(_WIN32)
+// Without the Windows SDK there is no way to sleep; both the bucket lock
+// and parked threads busy-wait.
+typedef int bucket_lock_t;
+
+static void bucket_lock(bucket_lock_t *l) {
+    while (__atomic_exchange_n(l, 1, __ATOMIC_ACQUIRE) != 0) {
+    }
+}
+
+static void bucket_unlock(bucket_lock_t *l) {
+    __atomic_store_n(l, 0, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    int signaled;
+} parker_t;
+
+static void parker_init(parker_t *p) {
+    p->signaled = 0;
+}
+
+static int parker_wait(parker_t *p, const uint64_t deadline_ns) {
+    while (__atomic_load_n(&p->signaled, __ATOMIC_ACQUIRE) == 0) {
+        if (deadline_ns != PARKING_LOT_FOREVER && parking_lot_now_ns() >= deadline_ns) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void parker_signal(parker_t *p) {
+    __atomic_store_n(&p->signaled, 1, __ATOMIC_RELEASE);
+}
+
+static void parker_destroy(parker_t *p) {
+    (void) p;
+}
+#else
+// Generic POSIX: a yielding spin lock for the (tiny) bucket sections,
+// since pthread_mutex_t has no portable all-zero initializer.
+typedef int bucket_lock_t;
+
+static void bucket_lock(bucket_lock_t *l) {
+    while (__atomic_exchange_n(l, 1, __ATOMIC_ACQUIRE) != 0) {
+        sched_yield();
+    }
+}
+
+static void bucket_unlock(bucket_lock_t *l) {
+    __atomic_store_n(l, 0, __ATOMIC_RELEASE);
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int signaled;
+} parker_t;
+
+static void parker_init(parker_t *p) {
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    p->signaled = 0;
+}
+
+static int parker_wait(parker_t *p, const uint64_t deadline_ns) {
+    int signaled;
+    pthread_mutex_lock(&p->lock);
+    while (!p->signaled) {
+        if (deadline_ns == PARKING_LOT_FOREVER) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+
+        const uint64_t now = parking_lot_now_ns();
+        if (now >= deadline_ns) {
+            break;
+        }
+
+        // Condition variables time out against CLOCK_REALTIME by default
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        const uint64_t abs_ns = (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec + (deadline_ns - now);
+        ts.tv_sec = (time_t) (abs_ns / 1000000000ULL);
+        ts.tv_nsec = (long) (abs_ns % 1000000000ULL);
+        pthread_cond_timedwait(&p->cond, &p->lock, &ts);
+    }
+    signaled = p->signaled;
+    pthread_mutex_unlock(&p->lock);
+    return signaled;
+}
+
+static void parker_signal(parker_t *p) {
+    pthread_mutex_lock(&p->lock);
+    p->signaled = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void parker_destroy(parker_t *p) {
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+}
+#endif
+
+// ============= QUEUES =============
+/**
+ * @brief A parked thread. Lives on the parked thread's stack.
+ */
+typedef struct waiter {
+    struct waiter *next;
+    const void *addr;
+    uintptr_t token;
+    uint64_t enqueued_ns;
+    int queued;             // Still linked into its bucket (bucket lock held)
+    parker_t parker;
+} waiter_t;
+
+typedef struct {
+    bucket_lock_t lock;
+    waiter_t *head;
+    waiter_t *tail;
+} bucket_t;
+
+typedef union {
+    bucket_t bucket;
+    char pad[PARKING_LOT_CACHE_LINE];
+} padded_bucket_t;
+
+// All-zero is a valid, empty bucket on every platform
+static padded_bucket_t buckets[PARKING_LOT_BUCKETS];
+
+static bucket_t *bucket_for(const void *addr) {
+    uint64_t h = (uint64_t) (uintptr_t) addr;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return &buckets[h & (PARKING_LOT_BUCKETS - 1)].bucket;
+}
+
+static void bucket_append(bucket_t *b, waiter_t *w) {
+    w->next = NULL;
+    w->queued = 1;
+    if (b->tail) {
+        b->tail->next = w;
+    } else {
+        b->head = w;
+    }
+    b->tail = w;
+}
+
+static void bucket_unlink(bucket_t *b, waiter_t *prev, waiter_t *w) {
+    if (prev) {
+        prev->next = w->next;
+    } else {
+        b->head = w->next;
+    }
+    if (b->tail == w) {
+        b->tail = prev;
+    }
+    w->next = NULL;
+    w->queued = 0;
+}
+
+static int queue_has_addr(const waiter_t *from, const void *addr) {
+    for (const waiter_t *w = from; w; w = w->next) {
+        if (w->addr == addr) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+parking_lot_result_t parking_lot_park(
+    const void *addr,
+    const parking_lot_validate_t validate,
+    const parking_lot_timeout_t timed_out,
+    void *ctx,
+    const uint64_t timeout_ns,
+    uintptr_t *token
+) {
+    bucket_t *b = bucket_for(addr);
+    waiter_t self;
+    self.addr = addr;
+    self.token = 0;
+
+    bucket_lock(&b->lock);
+    if (validate && !validate(ctx)) {
+        bucket_unlock(&b->lock);
+        return PARKING_LOT_INVALID;
+    }
+
+    parker_init(&self.parker);
+    self.enqueued_ns = parking_lot_now_ns();
+    bucket_append(b, &self);
+    bucket_unlock(&b->lock);
+
+    uint64_t deadline = PARKING_LOT_FOREVER;
+    if (timeout_ns != PARKING_LOT_FOREVER) {
+        deadline = self.enqueued_ns + timeout_ns;
+        if (deadline < self.enqueued_ns) {
+            deadline = PARKING_LOT_FOREVER;
+        }
+    }
+
+    // Owner-aware spinners must not wait for a thread that sleeps here
+    mutex_thread_blocking_begin();
+    const int signaled = parker_wait(&self.parker, deadline);
+    mutex_thread_blocking_end();
+
+    if (!signaled) {
+        bucket_lock(&b->lock);
+        if (self.queued) {
+            // Still queued: nobody will signal us, so withdraw
+            waiter_t *prev = NULL;
+            for (waiter_t *w = b->head; w != &self; w = w->next) {
+                prev = w;
+            }
+            bucket_unlink(b, prev, &self);
+            if (timed_out) {
+                timed_out(ctx, queue_has_addr(b->head, addr));
+            }
+            bucket_unlock(&b->lock);
+            parker_destroy(&self.parker);
+            return PARKING_LOT_TIMED_OUT;
+        }
+        bucket_unlock(&b->lock);
+
+        // An unparker dequeued us concurrently; its signal is imminent
+        parker_wait(&self.parker, PARKING_LOT_FOREVER);
+    }
+
+    parker_destroy(&self.parker);
+    if (token) {
+        *token = self.token;
+    }
+    return PARKING_LOT_UNPARKED;
+}
+
+parking_lot_unpark_result_t parking_lot_unpark_one(
+    const void *addr,
+    const parking_lot_callback_t callback,
+    void *ctx
+) {
+    bucket_t *b = bucket_for(addr);
+    parking_lot_unpark_result_t result = { 0, 0, 0 };
+    waiter_t *target = NULL;
+
+    bucket_lock(&b->lock);
+    waiter_t *prev = NULL;
+    for (waiter_t *w = b->head; w; prev = w, w = w->next) {
+        if (w->addr == addr) {
+            target = w;
+            break;
+        }
+    }
+
+    if (target) {
+        waiter_t *rest = target->next;
+        bucket_unlink(b, prev, target);
+        result.unparked_thread = 1;
+        result.may_have_more = queue_has_addr(rest, addr);
+        const uint64_t now = parking_lot_now_ns();
+        result.wait_ns = now > target->enqueued_ns ? now - target->enqueued_ns : 0;
+    }
+
+    const uintptr_t token = callback ? callback(ctx, result) : 0;
+    if (target) {
+        target->token = token;
+    }
+    bucket_unlock(&b->lock);
+
+    if (target) {
+        parker_signal(&target->parker);
+    }
+    return result;
+}
+
+size_t parking_lot_unpark_all(const void *addr, const uintptr_t token) {
+    bucket_t *b = bucket_for(addr);
+    waiter_t *woken = NULL;
+    waiter_t *woken_tail = NULL;
+    size_t count = 0;
+
+    bucket_lock(&b->lock);
+    waiter_t *prev = NULL;
+    waiter_t *w = b->head;
+    while (w) {
+        waiter_t *next = w->next;
+        if (w->addr == addr) {
+            bucket_unlink(b, prev, w);
+            w->token = token;
+            // Keep FIFO order in the private wake list
+            if (woken_tail) {
+                woken_tail->next = w;
+            } else {
+                woken = w;
+            }
+            woken_tail = w;
+            count++;
+        } else {
+            prev = w;
+        }
+        w = next;
+    }
+    bucket_unlock(&b->lock);
+
+    while (woken) {
+        waiter_t *next = woken->next;
+        parker_signal(&woken->parker);
+        woken = next;
+    }
+    return count;
+}
@@ -0,0 +1,199 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_PARKING_LOT_LIBRARY_H
+#define FLUENT_LIBC_PARKING_LOT_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// parking_lot API
+// ----------------------------------------
+// Address-keyed wait queues shared by every blocking primitive of the
+// library. A thread "parks" on an arbitrary address and sleeps until
+// another thread "unparks" that address. Queues live in a global hash
+// table, so a lock only needs a couple of bits in its own word to know
+// whether anyone is waiting.
+//
+// Waiters on one address are woken in FIFO order, and the unparking
+// thread can pass a token to the woken thread (e.g. "the lock is yours"),
+// which is what makes direct lock handoff possible. For plain futex-style
+// waits on a 32-bit word, use wait.h instead.
+// ----------------------------------------
+// Features:
+// - parking_lot_park:       Sleep on an address if a condition still holds.
+// - parking_lot_unpark_one: Wake the oldest waiter on an address.
+// - parking_lot_unpark_all: Wake every waiter on an address.
+//
+// Function Signatures:
+// ----------------------------------------
+// parking_lot_result_t parking_lot_park(const void *addr,
+//                                       parking_lot_validate_t validate,
+//                                       parking_lot_timeout_t timed_out,
+//                                       void *ctx, uint64_t timeout_ns,
+//                                       uintptr_t *token);
+//     Example:
+//         parking_lot_park(&word, still_busy, NULL, &word, PARKING_LOT_FOREVER, NULL);
+//
+// parking_lot_unpark_result_t parking_lot_unpark_one(const void *addr,
+//                                                    parking_lot_callback_t callback,
+//                                                    void *ctx);
+//     Example:
+//         parking_lot_unpark_one(&word, NULL, NULL);
+//
+// size_t parking_lot_unpark_all(const void *addr, uintptr_t token);
+//     Example:
+//         parking_lot_unpark_all(&word, 0);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: linux/futex.h (Linux), windows.h (Win32), pthread.h (POSIX)
+// ----------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#   ifndef FLUENT_LIBC_NO_WINDOWS_SDK
+#      include <windows.h>
+#   else
+#      include <time.h>
+#   endif
+#else
+#   include <time.h>
+#endif
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Timeout value meaning "wait until unparked".
+ */
+#define PARKING_LOT_FOREVER UINT64_MAX
+
+/**
+ * @brief Outcome of parking_lot_park().
+ */
+typedef enum {
+    PARKING_LOT_UNPARKED = 0,   /**< Woken by an unpark call; the token is valid */
+    PARKING_LOT_INVALID,        /**< The validation callback refused to park */
+    PARKING_LOT_TIMED_OUT       /**< The timeout elapsed before an unpark */
+} parking_lot_result_t;
+
+/**
+ * @brief Information handed to the unpark_one callback.
+ */
+typedef struct {
+    int unparked_thread;  /**< Non-zero if a waiter was dequeued */
+    int may_have_more;    /**< Non-zero if other waiters remain on the address */
+    uint64_t wait_ns;     /**< How long the dequeued waiter had been parked */
+} parking_lot_unpark_result_t;
+
+/**
+ * @brief Decides, under the queue lock, whether the caller should still park.
+ */
+typedef int (*parking_lot_validate_t)(void *ctx);
+
+/**
+ * @brief Runs under the queue lock when a parked thread gives up on a timeout.
+ *
+ * `has_more` tells whether other waiters remain queued on the address.
+ */
+typedef void (*parking_lot_timeout_t)(void *ctx, int has_more);
+
+/**
+ * @brief Runs under the queue lock during parking_lot_unpark_one().
+ *
+ * The return value is delivered to the woken thread as its token.
+ */
+typedef uintptr_t (*parking_lot_callback_t)(void *ctx, parking_lot_unpark_result_t result);
+
+/**
+ * @brief Parks the calling thread on `addr`.
+ *
+ * `validate` is called with the queue lock held; returning 0 aborts the
+ * park, which closes the race against a concurrent unpark.
+ *
+ * @param addr Address to wait on. Never dereferenced.
+ * @param validate Optional park condition, called under the queue lock.
+ * @param timed_out Optional callback run under the queue lock on timeout.
+ * @param ctx Context for both callbacks.
+ * @param timeout_ns Relative timeout, or PARKING_LOT_FOREVER.
+ * @param token Optional output for the token passed by the unparker.
+ * @return How the park ended.
+ */
+parking_lot_result_t parking_lot_park(
+    const void *addr,
+    parking_lot_validate_t validate,
+    parking_lot_timeout_t timed_out,
+    void *ctx,
+    uint64_t timeout_ns,
+    uintptr_t *token
+);
+
+/**
+ * @brief Wakes the oldest thread parked on `addr`.
+ *
+ * The callback runs with the queue lock held, even when nobody was
+ * dequeued, so the caller can update its own state atomically with
+ * respect to parkers.
+ *
+ * @param addr Address to wake.
+ * @param callback Optional callback producing the token; 0 is sent if NULL.
+ * @param ctx Context for the callback.
+ * @return What happened, as also seen by the callback.
+ */
+parking_lot_unpark_result_t parking_lot_unpark_one(
+    const void *addr,
+    parking_lot_callback_t callback,
+    void *ctx
+);
+
+/**
+ * @brief Wakes every thread parked on `addr`.
+ *
+ * @param addr Address to wake.
+ * @param token Token delivered to each woken thread.
+ * @return The number of threads woken.
+ */
+size_t parking_lot_unpark_all(const void *addr, uintptr_t token);
+
+/**
+ * @brief Reads a monotonic clock in nanoseconds.
+ *
+ * @return Nanoseconds since an unspecified starting point.
+ */
+static inline uint64_t parking_lot_now_ns(void) {
+#   ifdef _WIN32
+#       ifndef FLUENT_LIBC_NO_WINDOWS_SDK
+            LARGE_INTEGER now, freq;
+            QueryPerformanceCounter(&now);
+            QueryPerformanceFrequency(&freq);
+            return (uint64_t) ((double) now.QuadPart * 1e9 / (double) freq.QuadPart);
+#       else
+            // Best effort: the CRT has no monotonic clock
+            struct timespec ts;
+            timespec_get(&ts, TIME_UTC);
+            return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#       endif
+#   else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+#   endif
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_PARKING_LOT_LIBRARY_H
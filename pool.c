@@ -0,0 +1,312 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include "pool.h"
+#include "mutex.h"
+
+/**
+ * @brief A free object. Objects are linked into magazines through `next`;
+ * the first object of a magazine links the global stack through
+ * `next_magazine`.
+ */
+typedef struct pool_obj {
+    struct pool_obj *next;
+    struct pool_obj *next_magazine;
+} pool_obj_t;
+
+/**
+ * @brief A thread's private free list for one pool.
+ */
+typedef struct {
+    pool_t *pool;
+    uint64_t id;          // pool->id when the entry was claimed
+    pool_obj_t *head;
+    uint32_t count;
+} pool_cache_t;
+
+// Pointer bits of the tagged stack top; the rest hold the ABA tag
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#   define POOL_PTR_BITS 48 // user-space addresses on x86-64 and AArch64
+#else
+#   define POOL_PTR_BITS 32
+#endif
+#define POOL_PTR_MASK ((((uint64_t) 1) << POOL_PTR_BITS) - 1)
+
+static uint64_t next_pool_id = 0;
+
+// Initialized pools; thread caches only flush into pools listed here
+static spinlock_t live_guard = SPINLOCK_INIT;
+static pool_t *live = NULL;
+
+static FLUENT_LIBC_THREAD_LOCAL pool_cache_t caches[POOL_THREAD_CACHES];
+static FLUENT_LIBC_THREAD_LOCAL uint32_t cache_victim = 0;
+static FLUENT_LIBC_THREAD_LOCAL int cache_registered = 0;
+
+// ============= GLOBAL STACK =============
+static pool_obj_t *stack_ptr(const uint64_t top) {
+    return (pool_obj_t *) (uintptr_t) (top & POOL_PTR_MASK);
+}
+
+static uint64_t stack_pack(const pool_obj_t *mag, const uint64_t old_top) {
+    const uint64_t tag = (old_top >> POOL_PTR_BITS) + 1;
+    return (tag << POOL_PTR_BITS) | (uint64_t) (uintptr_t) mag;
+}
+
+static void stack_push(pool_t *p, pool_obj_t *mag) {
+    uint64_t top = __atomic_load_n(&p->magazines.top, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&mag->next_magazine, stack_ptr(top), __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&p->magazines.top, &top, stack_pack(mag, top), 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static pool_obj_t *stack_pop(pool_t *p) {
+    uint64_t top = __atomic_load_n(&p->magazines.top, __ATOMIC_ACQUIRE);
+    for (;;) {
+        pool_obj_t *mag = stack_ptr(top);
+        if (!mag) {
+            return NULL;
+        }
+        // mag may already be popped and in use; slabs stay mapped, and the
+        // tag makes the exchange fail if the top changed meanwhile
+        pool_obj_t *next = __atomic_load_n(&mag->next_magazine, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&p->magazines.top, &top, stack_pack(next, top), 1,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return mag;
+        }
+    }
+}
+
+// ============= SLABS =============
+/**
+ * @brief Carves a new slab into magazines and pushes them all.
+ *
+ * Called with grow_lock held.
+ */
+static int pool_add_slab(pool_t *p) {
+    // The first stride holds the slab link, keeping objects 16-byte aligned
+    char *slab = (char *) malloc((p->slab_objects + 1) * p->obj_size);
+    if (!slab) {
+        return ENOMEM;
+    }
+    *(void **) slab = p->slabs;
+    p->slabs = slab;
+
+    char *obj = slab + p->obj_size;
+    for (size_t m = 0; m < p->slab_objects / POOL_MAGAZINE; m++) {
+        pool_obj_t *mag = (pool_obj_t *) obj;
+        for (uint32_t i = 0; i < POOL_MAGAZINE; i++) {
+            pool_obj_t *o = (pool_obj_t *) obj;
+            obj += p->obj_size;
+            o->next = i + 1 < POOL_MAGAZINE ? (pool_obj_t *) obj : NULL;
+        }
+        stack_push(p, mag);
+    }
+    return 0;
+}
+
+/**
+ * @brief Adds a slab unless another thread refilled the stack first.
+ */
+static int pool_grow(pool_t *p) {
+    int err = 0;
+    spinlock_lock(&p->grow_lock);
+    if (!stack_ptr(__atomic_load_n(&p->magazines.top, __ATOMIC_ACQUIRE))) {
+        err = pool_add_slab(p);
+    }
+    spinlock_unlock(&p->grow_lock);
+    return err;
+}
+
+// ============= THREAD CACHES =============
+/**
+ * @brief Returns a cache's objects to its pool, or drops them if the pool
+ * was destroyed, and empties the entry.
+ */
+static void cache_flush(pool_cache_t *c) {
+    if (c->head) {
+        spinlock_lock(&live_guard);
+        for (pool_t *p = live; p; p = p->next_live) {
+            if (p == c->pool && p->id == c->id) {
+                stack_push(p, c->head);
+                break;
+            }
+        }
+        spinlock_unlock(&live_guard);
+    }
+    c->pool = NULL;
+    c->id = 0;
+    c->head = NULL;
+    c->count = 0;
+}
+
+#ifndef _WIN32
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+static void cache_release(void *arg) {
+    pool_cache_t *mine = (pool_cache_t *) arg;
+    for (uint32_t i = 0; i < POOL_THREAD_CACHES; i++) {
+        cache_flush(&mine[i]);
+    }
+}
+
+static void cache_key_create(void) {
+    pthread_key_create(&cache_key, cache_release);
+}
+#endif
+
+static pool_cache_t *cache_claim(pool_cache_t *c, pool_t *p) {
+    c->pool = p;
+    c->id = p->id;
+    c->head = NULL;
+    c->count = 0;
+    if (!cache_registered) {
+#ifndef _WIN32
+        // Return cached objects at thread exit (Windows threads keep theirs)
+        pthread_once(&cache_once, cache_key_create);
+        pthread_setspecific(cache_key, caches);
+#endif
+        cache_registered = 1;
+    }
+    return c;
+}
+
+static pool_cache_t *cache_for(pool_t *p) {
+    for (uint32_t i = 0; i < POOL_THREAD_CACHES; i++) {
+        pool_cache_t *c = &caches[i];
+        if (c->pool == p) {
+            if (c->id == p->id) {
+                return c;
+            }
+            // Left over from a destroyed pool at the same address
+            cache_flush(c);
+            return cache_claim(c, p);
+        }
+    }
+    for (uint32_t i = 0; i < POOL_THREAD_CACHES; i++) {
+        if (!caches[i].pool) {
+            return cache_claim(&caches[i], p);
+        }
+    }
+
+    pool_cache_t *c = &caches[cache_victim++ % POOL_THREAD_CACHES];
+    cache_flush(c);
+    return cache_claim(c, p);
+}
+
+// ============= API =============
+int pool_init(pool_t *p, size_t obj_size) {
+    if (obj_size == 0 || obj_size > POOL_SLAB_BYTES) {
+        return EINVAL;
+    }
+    if (obj_size < sizeof(pool_obj_t)) {
+        obj_size = sizeof(pool_obj_t);
+    }
+    obj_size = (obj_size + 15) & ~(size_t) 15;
+
+    size_t per_slab = POOL_SLAB_BYTES / obj_size / POOL_MAGAZINE * POOL_MAGAZINE;
+    if (per_slab == 0) {
+        per_slab = POOL_MAGAZINE;
+    }
+
+    p->magazines.top = 0;
+    p->obj_size = obj_size;
+    p->slab_objects = per_slab;
+    p->id = __atomic_add_fetch(&next_pool_id, 1, __ATOMIC_RELAXED);
+    spinlock_init(&p->grow_lock);
+    p->slabs = NULL;
+
+    spinlock_lock(&live_guard);
+    p->next_live = live;
+    live = p;
+    spinlock_unlock(&live_guard);
+    return 0;
+}
+
+int pool_reserve(pool_t *p, const size_t count) {
+    const size_t slabs = (count + p->slab_objects - 1) / p->slab_objects;
+    int err = 0;
+    spinlock_lock(&p->grow_lock);
+    for (size_t i = 0; i < slabs && err == 0; i++) {
+        err = pool_add_slab(p);
+    }
+    spinlock_unlock(&p->grow_lock);
+    return err;
+}
+
+void *pool_alloc(pool_t *p) {
+    pool_cache_t *c = cache_for(p);
+    pool_obj_t *o = c->head;
+    if (o) {
+        c->head = o->next;
+        c->count--;
+        return o;
+    }
+
+    while (!(o = stack_pop(p))) {
+        if (pool_grow(p) != 0) {
+            return NULL;
+        }
+    }
+
+    // Magazines returned at thread exit may be partial, so count
+    uint32_t n = 0;
+    for (const pool_obj_t *it = o->next; it; it = it->next) {
+        n++;
+    }
+    c->head = o->next;
+    c->count = n;
+    return o;
+}
+
+void pool_free(pool_t *p, void *obj) {
+    pool_cache_t *c = cache_for(p);
+    pool_obj_t *o = (pool_obj_t *) obj;
+    o->next = c->head;
+    c->head = o;
+    if (++c->count < 2 * POOL_MAGAZINE) {
+        return;
+    }
+
+    // Hand the most recently freed magazine to other threads
+    pool_obj_t *last = o;
+    for (uint32_t i = 1; i < POOL_MAGAZINE; i++) {
+        last = last->next;
+    }
+    c->head = last->next;
+    c->count -= POOL_MAGAZINE;
+    last->next = NULL;
+    stack_push(p, o);
+}
+
+void pool_destroy(pool_t *p) {
+    spinlock_lock(&live_guard);
+    for (pool_t **link = &live; *link; link = &(*link)->next_live) {
+        if (*link == p) {
+            *link = p->next_live;
+            break;
+        }
+    }
+    spinlock_unlock(&live_guard);
+
+    void *slab = p->slabs;
+    while (slab) {
+        void *next = *(void **) slab;
+        free(slab);
+        slab = next;
+    }
+    p->slabs = NULL;
+    p->magazines.top = 0;
+    p->id = 0;
+    spinlock_destroy(&p->grow_lock);
+}
@@ -0,0 +1,169 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_POOL_LIBRARY_H
+#define FLUENT_LIBC_POOL_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// pool_t API
+// ----------------------------------------
+// Fixed-size object pool for nodes that primitives allocate and free at
+// high rates: queue nodes, waiter records, retired-list entries.
+//
+// The design follows Bonwick's magazines. Each thread keeps a private
+// free list per pool, so pool_alloc() and pool_free() usually touch no
+// shared memory. When that list runs dry, the thread takes a whole
+// magazine of POOL_MAGAZINE objects from the pool's global stack with
+// one compare-and-swap. When it grows past two magazines, the thread
+// returns one the same way. The global stack is a Treiber stack whose
+// top pointer carries a modification tag against ABA.
+//
+// Objects are carved from slabs that are kept until pool_destroy(). A
+// pool only calls malloc when its global stack is empty, and
+// pool_reserve() can pre-fill it, so a primitive can keep allocation
+// out of its contended paths entirely.
+//
+// A thread caches objects for at most POOL_THREAD_CACHES pools at once;
+// its caches are returned to their pools when it exits.
+// ----------------------------------------
+// Features:
+// - pool_init:      Create a pool for objects of one size.
+// - pool_reserve:   Pre-allocate objects so later allocations skip malloc.
+// - pool_alloc:     Take an object.
+// - pool_free:      Give an object back.
+// - pool_destroy:   Release every slab.
+//
+// Function Signatures:
+// ----------------------------------------
+// int pool_init(pool_t *p, size_t obj_size);
+//     Example:
+//         pool_t nodes;
+//         pool_init(&nodes, sizeof(node_t));
+//
+// int pool_reserve(pool_t *p, size_t count);
+//     Example:
+//         pool_reserve(&nodes, 4096);
+//
+// void *pool_alloc(pool_t *p);
+//     Example:
+//         node_t *n = (node_t *) pool_alloc(&nodes);
+//
+// void pool_free(pool_t *p, void *obj);
+//     Example:
+//         pool_free(&nodes, n);
+//
+// void pool_destroy(pool_t *p);
+//     Example:
+//         pool_destroy(&nodes);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: spinlock.h
+// ----------------------------------------
+
+#include <stddef.h>
+#include <stdint.h>
+#include "spinlock.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Objects moved between a thread cache and the global stack at once.
+ */
+#ifndef POOL_MAGAZINE
+#   define POOL_MAGAZINE 32u
+#endif
+
+/**
+ * @brief Pools a single thread caches objects for at the same time.
+ */
+#ifndef POOL_THREAD_CACHES
+#   define POOL_THREAD_CACHES 8u
+#endif
+
+/**
+ * @brief Target size of one slab, in bytes.
+ */
+#ifndef POOL_SLAB_BYTES
+#   define POOL_SLAB_BYTES 65536u
+#endif
+
+/**
+ * @brief Global magazine stack: tagged top pointer on its own cache line.
+ */
+typedef union {
+    uint64_t top;   /**< Magazine pointer in the low bits, ABA tag in the high bits */
+    char pad[64];
+} pool_stack_t;
+
+/**
+ * @brief Object pool.
+ */
+typedef struct pool {
+    pool_stack_t magazines;   /**< Full magazines ready for any thread */
+    size_t obj_size;          /**< Object stride, a multiple of 16 */
+    size_t slab_objects;      /**< Objects per slab, a multiple of POOL_MAGAZINE */
+    uint64_t id;              /**< Unique per pool_init(); detects stale thread caches */
+    spinlock_t grow_lock;     /**< Serializes slab allocation */
+    void *slabs;              /**< Every slab, linked through its first word */
+    struct pool *next_live;   /**< Link in the list of initialized pools */
+} pool_t;
+
+/**
+ * @brief Initializes an empty pool.
+ *
+ * @param p Pointer to the pool_t structure to initialize.
+ * @param obj_size Object size; rounded up to a multiple of 16 bytes.
+ * @return 0 on success, EINVAL for a zero size.
+ */
+int pool_init(pool_t *p, size_t obj_size);
+
+/**
+ * @brief Allocates slabs until at least `count` objects are available
+ * without further calls to malloc.
+ *
+ * @param p The pool.
+ * @param count Objects to add to the global stack.
+ * @return 0 on success, ENOMEM on allocation failure.
+ */
+int pool_reserve(pool_t *p, size_t count);
+
+/**
+ * @brief Takes an object from the pool. Its contents are undefined.
+ *
+ * @param p The pool.
+ * @return The object, or NULL if a slab could not be allocated.
+ */
+void *pool_alloc(pool_t *p);
+
+/**
+ * @brief Returns an object to the pool. Any thread may free any object.
+ *
+ * @param p The pool the object came from.
+ * @param obj The object.
+ */
+void pool_free(pool_t *p, void *obj);
+
+/**
+ * @brief Releases every slab. No thread may use the pool or its objects
+ * afterwards; stale thread caches are discarded on their next use.
+ */
+void pool_destroy(pool_t *p);
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_POOL_LIBRARY_H
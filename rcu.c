@@ -0,0 +1,440 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include "rcu.h"
+#include "thread_registry.h"
+#include "wait.h"
+
+#ifdef __linux__
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#   include <linux/membarrier.h>
+#endif
+
+/**
+ * @brief Yields a grace period spends polling before it sleeps.
+ */
+#ifndef RCU_WAIT_SPINS
+#   define RCU_WAIT_SPINS 100
+#endif
+
+/**
+ * @brief Longest sleep between two polls of the readers, in nanoseconds.
+ */
+#ifndef RCU_WAIT_TIMEOUT_NS
+#   define RCU_WAIT_TIMEOUT_NS 1000000ULL
+#endif
+
+uint64_t rcu_gp_ctr = RCU_GP_COUNT;
+uint32_t rcu_gp_waiting = 0;
+int rcu_use_membarrier = 0;
+
+// Serializes grace periods of both flavors
+static mutex_t gp_lock;
+
+// Registries; push-only, so grace periods scan them without a lock
+static thread_registry_t readers = THREAD_REGISTRY_INIT(rcu_reader_t, r.next, r.next_free, "rcu");
+static thread_registry_t qsbr_readers = THREAD_REGISTRY_INIT(rcu_reader_t, r.next, r.next_free, "rcu");
+static size_t qsbr_count = 0;
+static uint64_t qsbr_gp = 1;
+
+static FLUENT_LIBC_THREAD_LOCAL rcu_reader_t *reader = NULL;
+static FLUENT_LIBC_THREAD_LOCAL rcu_reader_t *qsbr_reader = NULL;
+
+// ============= MEMORY BARRIERS =============
+#ifdef __linux__
+static pthread_once_t membarrier_once = PTHREAD_ONCE_INIT;
+
+static void rcu_membarrier_register(void) {
+    const long cmds = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0);
+    if (cmds > 0 && (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED)
+        && syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0) {
+        __atomic_store_n(&rcu_use_membarrier, 1, __ATOMIC_RELEASE);
+    }
+}
+#endif
+
+/**
+ * @brief Decides once, before any reader or writer runs, whether readers
+ * may skip their fence.
+ */
+static void rcu_membarrier_init(void) {
+#ifdef __linux__
+    pthread_once(&membarrier_once, rcu_membarrier_register);
+#endif
+}
+
+/**
+ * @brief Full barrier on the calling thread and, with membarrier, on every
+ * running thread of the process.
+ */
+static void rcu_mb_all(void) {
+#ifdef __linux__
+    if (__atomic_load_n(&rcu_use_membarrier, __ATOMIC_ACQUIRE)) {
+        syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+        return;
+    }
+#endif
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// ============= READER RECORDS =============
+static void record_give_back(rcu_reader_t *self, thread_registry_t *registry) {
+    __atomic_store_n(&self->r.ctr, 0, __ATOMIC_RELEASE);
+    thread_registry_give_back(registry, self);
+}
+
+#ifndef _WIN32
+static pthread_key_t reader_key;
+static pthread_once_t reader_once = PTHREAD_ONCE_INIT;
+
+static void reader_release(void *arg) {
+    record_give_back((rcu_reader_t *) arg, &readers);
+}
+
+static void reader_key_create(void) {
+    pthread_key_create(&reader_key, reader_release);
+}
+#endif
+
+rcu_reader_t *rcu_reader_record(void) {
+    rcu_reader_t *self = reader;
+    if (self) {
+        return self;
+    }
+
+    rcu_membarrier_init();
+    self = (rcu_reader_t *) thread_registry_take(&readers);
+#ifndef _WIN32
+    // Recycle the record at thread exit (Windows threads keep theirs)
+    pthread_once(&reader_once, reader_key_create);
+    pthread_setspecific(reader_key, self);
+#endif
+    reader = self;
+    return self;
+}
+
+// ============= GRACE PERIODS =============
+void rcu_wake_writer(void) {
+    if (__atomic_exchange_n(&rcu_gp_waiting, 0, __ATOMIC_RELAXED)) {
+        wake_all(&rcu_gp_waiting);
+    }
+}
+
+/**
+ * @brief Polls `pending` until it reports no blocking reader, sleeping
+ * between polls once yielding stops paying off.
+ */
+static void rcu_wait(int (*pending)(void)) {
+    for (int spins = 0; pending(); spins++) {
+        if (spins < RCU_WAIT_SPINS) {
+            mutex_thread_yield();
+            continue;
+        }
+        // Readers leaving a section see the flag and wake us. Readers that
+        // skip their fence rely on the membarrier to order their counter
+        // store against the flag load; the timeout is a last resort
+        __atomic_store_n(&rcu_gp_waiting, 1, __ATOMIC_RELAXED);
+        rcu_mb_all();
+        if (pending()) {
+            wait_on_address(&rcu_gp_waiting, 1, RCU_WAIT_TIMEOUT_NS);
+        }
+    }
+    __atomic_store_n(&rcu_gp_waiting, 0, __ATOMIC_RELAXED);
+}
+
+static int readers_pending(void) {
+    const uint64_t gp = __atomic_load_n(&rcu_gp_ctr, __ATOMIC_RELAXED);
+    for (rcu_reader_t *r = (rcu_reader_t *) __atomic_load_n(&readers.head, __ATOMIC_ACQUIRE); r; r = r->r.next) {
+        const uint64_t ctr = __atomic_load_n(&r->r.ctr, __ATOMIC_RELAXED);
+        // In a section that started before the last phase flip
+        if ((ctr & RCU_NEST_MASK) && ((ctr ^ gp) & RCU_GP_PHASE)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void synchronize_rcu(void) {
+    rcu_membarrier_init();
+    mutex_lock(&gp_lock);
+
+    // Updates made before the call are visible to every later reader
+    rcu_mb_all();
+
+    // Two flips: a reader may have loaded rcu_gp_ctr just before the
+    // first one and store it after
+    for (int flip = 0; flip < 2; flip++) {
+        __atomic_store_n(&rcu_gp_ctr, rcu_gp_ctr ^ RCU_GP_PHASE, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        rcu_wait(readers_pending);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    // Readers' loads are complete before the caller frees anything
+    rcu_mb_all();
+    mutex_unlock(&gp_lock);
+}
+
+// ============= QSBR =============
+void rcu_register_thread_qsbr(void) {
+    if (qsbr_reader) {
+        return;
+    }
+    qsbr_reader = (rcu_reader_t *) thread_registry_take(&qsbr_readers);
+    __atomic_add_fetch(&qsbr_count, 1, __ATOMIC_RELAXED);
+    rcu_thread_online();
+}
+
+void rcu_unregister_thread_qsbr(void) {
+    if (!qsbr_reader) {
+        return;
+    }
+    rcu_thread_offline();
+    record_give_back(qsbr_reader, &qsbr_readers);
+    __atomic_sub_fetch(&qsbr_count, 1, __ATOMIC_RELAXED);
+    qsbr_reader = NULL;
+}
+
+void rcu_quiescent_state(void) {
+    if (!qsbr_reader) {
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&qsbr_reader->r.ctr, __atomic_load_n(&qsbr_gp, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rcu_gp_waiting, __ATOMIC_RELAXED)) {
+        rcu_wake_writer();
+    }
+}
+
+void rcu_thread_offline(void) {
+    if (!qsbr_reader) {
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&qsbr_reader->r.ctr, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&rcu_gp_waiting, __ATOMIC_RELAXED)) {
+        rcu_wake_writer();
+    }
+}
+
+void rcu_thread_online(void) {
+    if (!qsbr_reader) {
+        return;
+    }
+    __atomic_store_n(&qsbr_reader->r.ctr, __atomic_load_n(&qsbr_gp, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static int qsbr_pending(void) {
+    const uint64_t gp = __atomic_load_n(&qsbr_gp, __ATOMIC_RELAXED);
+    for (rcu_reader_t *r = (rcu_reader_t *) __atomic_load_n(&qsbr_readers.head, __ATOMIC_ACQUIRE); r; r = r->r.next) {
+        const uint64_t ctr = __atomic_load_n(&r->r.ctr, __ATOMIC_RELAXED);
+        if (ctr != 0 && ctr != gp) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void synchronize_rcu_qsbr(void) {
+    // A QSBR caller cannot pass a quiescent state while it waits
+    const int was_online = qsbr_reader && __atomic_load_n(&qsbr_reader->r.ctr, __ATOMIC_RELAXED) != 0;
+    if (was_online) {
+        rcu_thread_offline();
+    }
+
+    mutex_lock(&gp_lock);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __atomic_store_n(&qsbr_gp, qsbr_gp + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    rcu_wait(qsbr_pending);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    mutex_unlock(&gp_lock);
+
+    if (was_online) {
+        rcu_thread_online();
+    }
+}
+
+// ============= CALL_RCU =============
+static rcu_head_t *cb_head = NULL;
+static uint64_t cb_queued = 0;
+static uint64_t cb_done = 0;
+static uint32_t cb_signal = 0;
+static uint32_t cb_sleeping = 0;
+static uint32_t cb_batches = 0;
+static int cb_started = 0;
+
+/**
+ * @brief Waits out one grace period of each flavor in use.
+ */
+static void rcu_grace_period_all(void) {
+    synchronize_rcu();
+    if (__atomic_load_n(&qsbr_count, __ATOMIC_RELAXED) != 0) {
+        synchronize_rcu_qsbr();
+    }
+}
+
+/**
+ * @brief Runs a detached batch oldest first.
+ *
+ * @return Number of callbacks run.
+ */
+static uint64_t rcu_run_batch(rcu_head_t *list) {
+    rcu_head_t *fifo = NULL;
+    while (list) {
+        rcu_head_t *next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    uint64_t n = 0;
+    while (fifo) {
+        rcu_head_t *next = fifo->next;
+        fifo->func(fifo);
+        fifo = next;
+        n++;
+    }
+    return n;
+}
+
+/**
+ * @brief Waits out a grace period for a detached batch, runs it and
+ * tells rcu_barrier() about it.
+ */
+static void rcu_reclaim_batch(rcu_head_t *list) {
+    rcu_grace_period_all();
+    const uint64_t n = rcu_run_batch(list);
+
+    __atomic_add_fetch(&cb_done, n, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&cb_batches, 1, __ATOMIC_RELEASE);
+    wake_all(&cb_batches);
+}
+
+/**
+ * @brief Without a reclaim thread: reclaims everything queued so far on
+ * the calling thread, which must not be inside a read-side section.
+ */
+static void rcu_reclaim_inline(void) {
+    rcu_head_t *list = __atomic_exchange_n(&cb_head, NULL, __ATOMIC_ACQUIRE);
+    if (list) {
+        rcu_reclaim_batch(list);
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI rcu_reclaim_thread(LPVOID arg) {
+#else
+static void *rcu_reclaim_thread(void *arg) {
+#endif
+    (void) arg;
+    for (;;) {
+        rcu_head_t *list = __atomic_exchange_n(&cb_head, NULL, __ATOMIC_ACQUIRE);
+        if (!list) {
+            const uint32_t signal = __atomic_load_n(&cb_signal, __ATOMIC_ACQUIRE);
+            __atomic_store_n(&cb_sleeping, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&cb_head, __ATOMIC_SEQ_CST) == NULL) {
+                wait_on_address(&cb_signal, signal, WAIT_FOREVER);
+            }
+            __atomic_store_n(&cb_sleeping, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        rcu_reclaim_batch(list);
+    }
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Starts the reclaim thread once.
+ *
+ * @return 1 if it runs, 0 if it could not be created.
+ */
+static int rcu_reclaim_start(void) {
+    int state = __atomic_load_n(&cb_started, __ATOMIC_ACQUIRE);
+    if (state == 1) {
+        return 1;
+    }
+
+    state = 0;
+    if (!__atomic_compare_exchange_n(&cb_started, &state, 2, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        // Another thread is starting it, or already did
+        while ((state = __atomic_load_n(&cb_started, __ATOMIC_ACQUIRE)) == 2) {
+            mutex_thread_yield();
+        }
+        return state == 1;
+    }
+
+#ifdef _WIN32
+    HANDLE thread = CreateThread(NULL, 0, rcu_reclaim_thread, NULL, 0, NULL);
+    const int ok = thread != NULL;
+    if (ok) {
+        CloseHandle(thread);
+    }
+#else
+    pthread_t thread;
+    const int ok = pthread_create(&thread, NULL, rcu_reclaim_thread, NULL) == 0;
+    if (ok) {
+        pthread_detach(thread);
+    }
+#endif
+    __atomic_store_n(&cb_started, ok ? 1 : 0, __ATOMIC_RELEASE);
+    return ok;
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *)) {
+    head->func = func;
+    __atomic_add_fetch(&cb_queued, 1, __ATOMIC_RELAXED);
+
+    rcu_head_t *old = __atomic_load_n(&cb_head, __ATOMIC_RELAXED);
+    do {
+        head->next = old;
+    } while (!__atomic_compare_exchange_n(&cb_head, &old, head, 1,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+    if (!rcu_reclaim_start()) {
+        // No thread to defer to: wait out the grace period here. A caller
+        // inside a read-side section would wait for itself, so its
+        // callbacks stay queued for the next call_rcu() or rcu_barrier()
+        // made outside one
+        if (!reader || (__atomic_load_n(&reader->r.ctr, __ATOMIC_RELAXED) & RCU_NEST_MASK) == 0) {
+            rcu_reclaim_inline();
+        }
+        return;
+    }
+
+    if (__atomic_load_n(&cb_sleeping, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&cb_signal, 1, __ATOMIC_RELEASE);
+        wake_one(&cb_signal);
+    }
+}
+
+void rcu_barrier(void) {
+    const uint64_t target = __atomic_load_n(&cb_queued, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&cb_started, __ATOMIC_ACQUIRE) == 0) {
+        // No reclaim thread; run what call_rcu() had to leave queued
+        rcu_reclaim_inline();
+    }
+    for (;;) {
+        const uint32_t batches = __atomic_load_n(&cb_batches, __ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&cb_done, __ATOMIC_ACQUIRE) >= target) {
+            return;
+        }
+        wait_on_address(&cb_batches, batches, WAIT_FOREVER);
+    }
+}
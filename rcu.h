@@ -0,0 +1,298 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_RCU_LIBRARY_H
+#define FLUENT_LIBC_RCU_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// rcu API
+// ----------------------------------------
+// Userspace read-copy-update for read-mostly data (routing tables,
+// configuration snapshots). Readers access the current version through
+// rcu_dereference(). Writers publish a new version with
+// rcu_assign_pointer(), then free the old one after a grace period, that
+// is, once every reader that might still see it has finished.
+//
+// Two flavors share one grace-period machinery:
+//
+// - General purpose: rcu_read_lock()/rcu_read_unlock() bracket read-side
+//   sections. On Linux the writer forces memory barriers on every running
+//   thread with the membarrier system call, so a reader only stores its
+//   phase word with no fence. Elsewhere readers add one full fence on
+//   entry.
+// - QSBR (quiescent-state-based): reads carry no markers at all.
+//   Registered threads instead call rcu_quiescent_state() from time to
+//   time at points where they hold no RCU pointers, and go offline
+//   around blocking calls.
+//
+// synchronize_rcu() waits for a grace period of the general flavor and
+// synchronize_rcu_qsbr() for one of QSBR. call_rcu() queues a callback
+// for a background thread. That thread waits out one grace period of
+// each flavor per batch and then runs the batch, so call_rcu() works
+// with readers of either flavor.
+// ----------------------------------------
+// Features:
+// - rcu_read_lock / rcu_read_unlock:     General-purpose read-side section.
+// - rcu_dereference / rcu_assign_pointer: Read and publish RCU pointers.
+// - synchronize_rcu:                     Wait for pre-existing readers.
+// - call_rcu:                            Run a callback after a grace period.
+// - rcu_barrier:                         Wait for queued callbacks to finish.
+// - rcu_register_thread_qsbr:            Make the calling thread a QSBR reader.
+// - rcu_unregister_thread_qsbr:          Stop being a QSBR reader.
+// - rcu_quiescent_state:                 Report a QSBR quiescent state.
+// - rcu_thread_offline / rcu_thread_online: Leave and rejoin QSBR around blocking.
+// - synchronize_rcu_qsbr:                Wait for a QSBR grace period.
+//
+// Function Signatures:
+// ----------------------------------------
+// void rcu_read_lock(void);
+// void rcu_read_unlock(void);
+//     Example:
+//         rcu_read_lock();
+//         route_table_t *t = rcu_dereference(routes);
+//         lookup(t, addr);
+//         rcu_read_unlock();
+//
+// void synchronize_rcu(void);
+//     Example:
+//         route_table_t *old = routes;
+//         rcu_assign_pointer(routes, fresh);
+//         synchronize_rcu();
+//         free(old);
+//
+// void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *));
+//     Example:
+//         call_rcu(&old->rcu, table_free);
+//
+// void rcu_barrier(void);
+//     Example:
+//         rcu_barrier(); // before unloading the code of the callbacks
+//
+// void rcu_register_thread_qsbr(void);
+// void rcu_quiescent_state(void);
+// void rcu_unregister_thread_qsbr(void);
+//     Example:
+//         rcu_register_thread_qsbr();
+//         while (serve(rcu_dereference(flags))) rcu_quiescent_state();
+//         rcu_unregister_thread_qsbr();
+//
+// void rcu_thread_offline(void);
+// void rcu_thread_online(void);
+//     Example:
+//         rcu_thread_offline();
+//         poll(fds, n, -1);
+//         rcu_thread_online();
+//
+// void synchronize_rcu_qsbr(void);
+//     Example:
+//         synchronize_rcu_qsbr();
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h, thread_registry.h, wait.h, linux/membarrier.h (Linux)
+// ----------------------------------------
+
+#include <stdint.h>
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Nesting unit of a reader's counter word.
+ */
+#define RCU_GP_COUNT ((uint64_t) 1)
+
+/**
+ * @brief Bits of a reader's counter word that hold the nesting depth.
+ */
+#define RCU_NEST_MASK ((((uint64_t) 1) << 32) - 1)
+
+/**
+ * @brief Grace-period phase bit, flipped by the writer.
+ */
+#define RCU_GP_PHASE (((uint64_t) 1) << 32)
+
+/**
+ * @brief Reads an RCU-protected pointer inside a read-side section.
+ */
+#define rcu_dereference(p) __atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+/**
+ * @brief Publishes a fully initialized object to RCU readers.
+ */
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/**
+ * @brief Link embedded in objects handed to call_rcu().
+ */
+typedef struct rcu_head {
+    struct rcu_head *next;               /**< Next queued callback */
+    void (*func)(struct rcu_head *);     /**< Runs after the grace period */
+} rcu_head_t;
+
+/**
+ * @brief Per-thread reader record, on its own cache line.
+ */
+typedef union rcu_reader {
+    struct {
+        uint64_t ctr;                    /**< Phase and nesting (general) or last seen grace period (QSBR); 0 when idle/offline */
+        union rcu_reader *next;          /**< Registry link; records are never freed */
+        union rcu_reader *next_free;     /**< Link in the recycled-record list */
+    } r;
+    char pad[64];
+} rcu_reader_t;
+
+/**
+ * @brief Global phase word readers copy on entry (general flavor).
+ */
+extern uint64_t rcu_gp_ctr;
+
+/**
+ * @brief Non-zero while a grace period waits for readers to wake it.
+ */
+extern uint32_t rcu_gp_waiting;
+
+/**
+ * @brief Non-zero once the writer side uses membarrier; readers then skip their fence.
+ */
+extern int rcu_use_membarrier;
+
+/**
+ * @brief Returns the calling thread's general-flavor record, registering it on first use.
+ */
+rcu_reader_t *rcu_reader_record(void);
+
+/**
+ * @brief Wakes a grace period waiting for readers.
+ */
+void rcu_wake_writer(void);
+
+/**
+ * @brief Waits until every general-flavor read-side section that started
+ * before the call has finished.
+ *
+ * Must not be called inside a read-side section.
+ */
+void synchronize_rcu(void);
+
+/**
+ * @brief Runs `func(head)` on the reclaim thread after a grace period.
+ *
+ * May be called inside a read-side section. If the reclaim thread cannot
+ * be created, the caller waits out the grace period and runs the
+ * callbacks itself; inside a read-side section they are then left queued
+ * until the next call_rcu() or rcu_barrier() outside one.
+ *
+ * @param head Link embedded in the object.
+ * @param func Callback; usually frees the enclosing object.
+ */
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *));
+
+/**
+ * @brief Waits until every callback queued before the call has run.
+ *
+ * Must not be called inside a read-side section.
+ */
+void rcu_barrier(void);
+
+/**
+ * @brief Registers the calling thread as an online QSBR reader.
+ */
+void rcu_register_thread_qsbr(void);
+
+/**
+ * @brief Unregisters the calling QSBR reader.
+ */
+void rcu_unregister_thread_qsbr(void);
+
+/**
+ * @brief Reports that the calling QSBR reader holds no RCU pointers.
+ */
+void rcu_quiescent_state(void);
+
+/**
+ * @brief Marks the calling QSBR reader offline (e.g. before blocking).
+ */
+void rcu_thread_offline(void);
+
+/**
+ * @brief Brings the calling QSBR reader back online.
+ */
+void rcu_thread_online(void);
+
+/**
+ * @brief Waits until every online QSBR reader has passed a quiescent state.
+ */
+void synchronize_rcu_qsbr(void);
+
+static inline rcu_reader_t *rcu_self(void) {
+    static FLUENT_LIBC_THREAD_LOCAL rcu_reader_t *self = NULL;
+    if (!self) {
+        self = rcu_reader_record();
+    }
+    return self;
+}
+
+/**
+ * @brief Orders a reader's counter store against its section.
+ */
+static inline void rcu_reader_barrier(void) {
+    if (__atomic_load_n(&rcu_use_membarrier, __ATOMIC_RELAXED)) {
+        // The writer's membarrier supplies the hardware fence
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    } else {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * @brief Enters a general-flavor read-side section. Sections nest.
+ */
+static inline void rcu_read_lock(void) {
+    rcu_reader_t *self = rcu_self();
+    const uint64_t ctr = self->r.ctr;
+    if ((ctr & RCU_NEST_MASK) == 0) {
+        // rcu_gp_ctr always carries a nesting count of one
+        __atomic_store_n(&self->r.ctr, __atomic_load_n(&rcu_gp_ctr, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        rcu_reader_barrier();
+    } else {
+        __atomic_store_n(&self->r.ctr, ctr + RCU_GP_COUNT, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Leaves a general-flavor read-side section.
+ */
+static inline void rcu_read_unlock(void) {
+    rcu_reader_t *self = rcu_self();
+    const uint64_t ctr = self->r.ctr;
+    if ((ctr & RCU_NEST_MASK) == RCU_GP_COUNT) {
+        rcu_reader_barrier();
+        __atomic_store_n(&self->r.ctr, ctr - RCU_GP_COUNT, __ATOMIC_RELAXED);
+        // Store before load: else the writer sees us inside and we miss its flag
+        rcu_reader_barrier();
+        if (__atomic_load_n(&rcu_gp_waiting, __ATOMIC_RELAXED)) {
+            rcu_wake_writer();
+        }
+    } else {
+        __atomic_store_n(&self->r.ctr, ctr - RCU_GP_COUNT, __ATOMIC_RELAXED);
+    }
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_RCU_LIBRARY_H
@@ -0,0 +1,137 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_SDT_LIBRARY_H
+#define FLUENT_LIBC_SDT_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// Static user-space trace points
+// ----------------------------------------
+// FLUENT_SDT_PROBE0..3(provider, name, args...) place a SystemTap SDT
+// probe: a single nop at the probe site and an ELF note in
+// .note.stapsdt that records its address, provider, name and where
+// each argument lives. Tools that read these notes (bpftrace, perf,
+// SystemTap, bcc) turn the nop into a breakpoint while they are
+// attached; otherwise the probe costs the nop and whatever it takes to
+// keep the arguments in registers.
+//
+// When <sys/sdt.h> is available (systemtap-sdt-dev / systemtap-sdt-devel),
+// its DTRACE_PROBE macros are used. Otherwise this header emits the same
+// note format itself on ELF targets built with GCC or Clang, and defines
+// DTRACE_PROBE..DTRACE_PROBE3 if nothing else has. On other targets, or
+// with FLUENT_LIBC_NO_SDT defined, the probes expand to nothing.
+//
+// Arguments are passed as 64-bit (32-bit on ILP32) unsigned integers,
+// so pass pointers or integers.
+// ----------------------------------------
+// Function Signatures:
+// ----------------------------------------
+// FLUENT_SDT_PROBE0(provider, name)
+// FLUENT_SDT_PROBE1(provider, name, a1)
+// FLUENT_SDT_PROBE2(provider, name, a1, a2)
+// FLUENT_SDT_PROBE3(provider, name, a1, a2, a3)
+//     Example:
+//         FLUENT_SDT_PROBE1(mutex, lock_entry, m);
+//         // bpftrace -e 'usdt:./app:mutex:lock_entry { @[arg0] = count(); }'
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: sys/sdt.h (optional)
+// ----------------------------------------
+
+#if !defined(FLUENT_LIBC_NO_SDT) && defined(__has_include)
+#   if __has_include(<sys/sdt.h>)
+#       include <sys/sdt.h>
+#       define FLUENT_LIBC_SDT_SYSTEM 1
+#   endif
+#endif
+
+#if defined(FLUENT_LIBC_NO_SDT)
+#   define FLUENT_SDT_PROBE0(provider, name) do { } while (0)
+#   define FLUENT_SDT_PROBE1(provider, name, a1) do { (void) (a1); } while (0)
+#   define FLUENT_SDT_PROBE2(provider, name, a1, a2) do { (void) (a1); (void) (a2); } while (0)
+#   define FLUENT_SDT_PROBE3(provider, name, a1, a2, a3) \
+        do { (void) (a1); (void) (a2); (void) (a3); } while (0)
+#elif defined(FLUENT_LIBC_SDT_SYSTEM)
+#   define FLUENT_SDT_PROBE0(provider, name) DTRACE_PROBE(provider, name)
+#   define FLUENT_SDT_PROBE1(provider, name, a1) DTRACE_PROBE1(provider, name, a1)
+#   define FLUENT_SDT_PROBE2(provider, name, a1, a2) DTRACE_PROBE2(provider, name, a1, a2)
+#   define FLUENT_SDT_PROBE3(provider, name, a1, a2, a3) DTRACE_PROBE3(provider, name, a1, a2, a3)
+#elif defined(__ELF__) && defined(__GNUC__)
+#   include <stdint.h>
+
+#   if UINTPTR_MAX > 0xFFFFFFFFu
+#       define FLUENT_SDT_ADDR ".8byte"
+#   else
+#       define FLUENT_SDT_ADDR ".4byte"
+#   endif
+
+//  Argument n is printed as "<size>@<operand>"; %n negates the size constant
+#   define FLUENT_SDT_ARGFMT(n) "%n[fluent_sdt_s" #n "]@%[fluent_sdt_a" #n "]"
+#   define FLUENT_SDT_ARG(n, x) \
+        [fluent_sdt_s##n] "n" (-(int) sizeof(uintptr_t)), \
+        [fluent_sdt_a##n] "nor" ((uintptr_t) (x))
+
+//  The note layout matches <sys/sdt.h> version 3: probe address, base
+//  address (for prelink adjustment), semaphore (unused here), then the
+//  provider, probe and argument strings
+#   define FLUENT_SDT_ASM(provider, name, args) \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f-991f, 994f-993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: " FLUENT_SDT_ADDR " 990b\n" \
+        FLUENT_SDT_ADDR " _.stapsdt.base\n" \
+        FLUENT_SDT_ADDR " 0\n" \
+        ".asciz \"" #provider "\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"" args "\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n"
+
+#   define FLUENT_SDT_PROBE0(provider, name) \
+        __asm__ __volatile__(FLUENT_SDT_ASM(provider, name, ""))
+#   define FLUENT_SDT_PROBE1(provider, name, a1) \
+        __asm__ __volatile__(FLUENT_SDT_ASM(provider, name, FLUENT_SDT_ARGFMT(1)) \
+                             :: FLUENT_SDT_ARG(1, a1))
+#   define FLUENT_SDT_PROBE2(provider, name, a1, a2) \
+        __asm__ __volatile__(FLUENT_SDT_ASM(provider, name, FLUENT_SDT_ARGFMT(1) " " FLUENT_SDT_ARGFMT(2)) \
+                             :: FLUENT_SDT_ARG(1, a1), FLUENT_SDT_ARG(2, a2))
+#   define FLUENT_SDT_PROBE3(provider, name, a1, a2, a3) \
+        __asm__ __volatile__(FLUENT_SDT_ASM(provider, name, FLUENT_SDT_ARGFMT(1) " " FLUENT_SDT_ARGFMT(2) \
+                                                            " " FLUENT_SDT_ARGFMT(3)) \
+                             :: FLUENT_SDT_ARG(1, a1), FLUENT_SDT_ARG(2, a2), FLUENT_SDT_ARG(3, a3))
+
+#   ifndef DTRACE_PROBE
+#       define DTRACE_PROBE(provider, name) FLUENT_SDT_PROBE0(provider, name)
+#       define DTRACE_PROBE1(provider, name, a1) FLUENT_SDT_PROBE1(provider, name, a1)
+#       define DTRACE_PROBE2(provider, name, a1, a2) FLUENT_SDT_PROBE2(provider, name, a1, a2)
+#       define DTRACE_PROBE3(provider, name, a1, a2, a3) FLUENT_SDT_PROBE3(provider, name, a1, a2, a3)
+#   endif
+#else
+#   define FLUENT_SDT_PROBE0(provider, name) do { } while (0)
+#   define FLUENT_SDT_PROBE1(provider, name, a1) do { (void) (a1); } while (0)
+#   define FLUENT_SDT_PROBE2(provider, name, a1, a2) do { (void) (a1); (void) (a2); } while (0)
+#   define FLUENT_SDT_PROBE3(provider, name, a1, a2, a3) \
+        do { (void) (a1); (void) (a2); (void) (a3); } while (0)
+#endif
+
+#endif //FLUENT_LIBC_SDT_LIBRARY_H
@@ -0,0 +1,240 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_SEMAPHORE_LIBRARY_H
+#define FLUENT_LIBC_SEMAPHORE_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// semaphore_t API
+// ----------------------------------------
+// Counting semaphore. When permits are available, acquiring is a single
+// compare-and-swap; releasing is a single fetch-add plus a load that
+// skips the wake-up when nobody sleeps. Waiters sleep on the permit word
+// itself (futex on Linux, the parking lot elsewhere).
+//
+// Every call takes a permit count, so a thread can grab or return a
+// batch of permits at once.
+// ----------------------------------------
+// Features:
+// - semaphore_init:          Initialize with a number of permits.
+// - semaphore_acquire:       Take n permits, blocking until available.
+// - semaphore_try_acquire:   Take n permits if available right now.
+// - semaphore_acquire_timed: Take n permits, giving up after a timeout.
+// - semaphore_release:       Return n permits.
+// - semaphore_available:     Snapshot of the free permits.
+// - semaphore_destroy:       Clean up semaphore resources.
+//
+// Function Signatures:
+// ----------------------------------------
+// void semaphore_init(semaphore_t *s, uint32_t permits);
+//     Example:
+//         semaphore_t s;
+//         semaphore_init(&s, 16);
+//
+// void semaphore_acquire(semaphore_t *s, uint32_t n);
+//     Example:
+//         semaphore_acquire(&s, 1);
+//
+// int semaphore_try_acquire(semaphore_t *s, uint32_t n);
+//     Example:
+//         if (semaphore_try_acquire(&s, 4)) { ... }
+//
+// int semaphore_acquire_timed(semaphore_t *s, uint32_t n, uint64_t timeout_ns);
+//     Example:
+//         if (semaphore_acquire_timed(&s, 1, 5000000) == ETIMEDOUT) { ... }
+//
+// void semaphore_release(semaphore_t *s, uint32_t n);
+//     Example:
+//         semaphore_release(&s, 1);
+//
+// uint32_t semaphore_available(const semaphore_t *s);
+//     Example:
+//         printf("%u free\n", semaphore_available(&s));
+//
+// void semaphore_destroy(semaphore_t *s);
+//     Example:
+//         semaphore_destroy(&s);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: wait.h
+// ----------------------------------------
+
+#include <errno.h>
+#include "parking_lot.h"
+#include "wait.h"
+#include "mutex.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Pause-spins an acquirer does before sleeping.
+ */
+#ifndef SEMAPHORE_SPIN_LIMIT
+#   define SEMAPHORE_SPIN_LIMIT 100
+#endif
+
+/**
+ * @brief Counting semaphore.
+ */
+typedef struct {
+    uint32_t permits;       /**< Free permits; waiters sleep on this word */
+    uint32_t waiters;       /**< Threads in the sleeping slow path */
+    uint32_t batch_waiters; /**< Sleeping threads that want more than one permit */
+} semaphore_t;
+
+/**
+ * @brief Initializes the semaphore.
+ *
+ * @param s Pointer to the semaphore_t structure to initialize.
+ * @param permits Initial number of free permits.
+ */
+static inline void semaphore_init(semaphore_t *s, const uint32_t permits) {
+    s->permits = permits;
+    s->waiters = 0;
+    s->batch_waiters = 0;
+}
+
+/**
+ * @brief Takes n permits if they are available right now.
+ *
+ * @param s Pointer to the semaphore_t structure.
+ * @param n Number of permits.
+ * @return 1 if the permits were taken, 0 otherwise.
+ */
+static inline int semaphore_try_acquire(semaphore_t *s, const uint32_t n) {
+    uint32_t permits = __atomic_load_n(&s->permits, __ATOMIC_RELAXED);
+    while (permits >= n) {
+        if (__atomic_compare_exchange_n(&s->permits, &permits, permits - n, 1,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Takes n permits, sleeping until they are available or the timeout elapses.
+ *
+ * @param s Pointer to the semaphore_t structure.
+ * @param n Number of permits.
+ * @param timeout_ns Relative timeout, or PARKING_LOT_FOREVER.
+ * @return 0 on success, ETIMEDOUT if the permits could not be taken in time.
+ */
+static inline int semaphore_acquire_timed(semaphore_t *s, const uint32_t n, const uint64_t timeout_ns) {
+    if (semaphore_try_acquire(s, n)) {
+        return 0;
+    }
+
+    for (int i = 0; i < SEMAPHORE_SPIN_LIMIT; i++) {
+        mutex_cpu_relax();
+        if (semaphore_try_acquire(s, n)) {
+            return 0;
+        }
+    }
+
+    const uint64_t start = timeout_ns == PARKING_LOT_FOREVER ? 0 : parking_lot_now_ns();
+    int result = 0;
+
+    // seq_cst pairs with the releaser's permits/waiters accesses (Dekker style)
+    __atomic_add_fetch(&s->waiters, 1, __ATOMIC_SEQ_CST);
+    if (n > 1) {
+        __atomic_add_fetch(&s->batch_waiters, 1, __ATOMIC_SEQ_CST);
+    }
+
+    for (;;) {
+        uint32_t permits = __atomic_load_n(&s->permits, __ATOMIC_SEQ_CST);
+        if (permits >= n) {
+            if (__atomic_compare_exchange_n(&s->permits, &permits, permits - n, 1,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                break;
+            }
+            continue;
+        }
+
+        uint64_t remaining = PARKING_LOT_FOREVER;
+        if (timeout_ns != PARKING_LOT_FOREVER) {
+            const uint64_t elapsed = parking_lot_now_ns() - start;
+            if (elapsed >= timeout_ns) {
+                result = ETIMEDOUT;
+                break;
+            }
+            remaining = timeout_ns - elapsed;
+        }
+        wait_on_address(&s->permits, permits, remaining);
+    }
+
+    if (n > 1) {
+        __atomic_sub_fetch(&s->batch_waiters, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_sub_fetch(&s->waiters, 1, __ATOMIC_RELAXED);
+    return result;
+}
+
+/**
+ * @brief Takes n permits, sleeping until they are available.
+ *
+ * @param s Pointer to the semaphore_t structure.
+ * @param n Number of permits.
+ */
+static inline void semaphore_acquire(semaphore_t *s, const uint32_t n) {
+    semaphore_acquire_timed(s, n, PARKING_LOT_FOREVER);
+}
+
+/**
+ * @brief Returns n permits and wakes sleepers that may now proceed.
+ *
+ * @param s Pointer to the semaphore_t structure.
+ * @param n Number of permits.
+ */
+static inline void semaphore_release(semaphore_t *s, const uint32_t n) {
+    __atomic_add_fetch(&s->permits, n, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s->waiters, __ATOMIC_SEQ_CST) == 0) {
+        return;
+    }
+
+    // Single-permit sleepers: n wake-ups can use at most n permits.
+    // A batch sleeper might need more than any n woken threads leave
+    // behind, so then everyone re-checks.
+    const int batch = __atomic_load_n(&s->batch_waiters, __ATOMIC_SEQ_CST) != 0;
+    wake_n(&s->permits, batch ? WAIT_ALL : n);
+}
+
+/**
+ * @brief Returns a snapshot of the free permits.
+ *
+ * @param s Pointer to the semaphore_t structure.
+ * @return Permits free at the time of the call.
+ */
+static inline uint32_t semaphore_available(const semaphore_t *s) {
+    return __atomic_load_n(&s->permits, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Destroys the semaphore.
+ *
+ * The semaphore holds no resources; this exists for symmetry with mutex_t.
+ *
+ * @param s Pointer to the semaphore_t structure to destroy.
+ */
+static inline void semaphore_destroy(semaphore_t *s) {
+    (void) s;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_SEMAPHORE_LIBRARY_H
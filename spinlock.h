@@ -0,0 +1,290 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_SPINLOCK_LIBRARY_H
+#define FLUENT_LIBC_SPINLOCK_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// spinlock_t API
+// ----------------------------------------
+// Busy-waiting lock for very short critical sections on threads that
+// must never sleep (e.g. pinned packet-processing threads).
+// Unlike mutex_t, a spinlock_t never enters the kernel to wait.
+//
+// Contended acquisition is test-and-test-and-set: waiters spin on a
+// plain load with a CPU pause hint, and after every failed exchange back
+// off for a random number of pauses whose range doubles up to a cap.
+// After SPINLOCK_YIELD_AFTER pauses a waiter starts yielding its time
+// slice instead (define it to 0 to never yield).
+// ----------------------------------------
+// Features:
+// - spinlock_init:     Initialize a spinlock.
+// - spinlock_lock:     Acquire the spinlock (busy-waits if already locked).
+// - spinlock_trylock:  Acquire the spinlock if it is free.
+// - spinlock_unlock:   Release the spinlock.
+// - spinlock_destroy:  Clean up spinlock resources.
+//
+// Function Signatures:
+// ----------------------------------------
+// void spinlock_init(spinlock_t *s);
+//     Example:
+//         spinlock_t s;
+//         spinlock_init(&s);
+//
+// void spinlock_lock(spinlock_t *s);
+//     Example:
+//         spinlock_lock(&s);
+//
+// int spinlock_trylock(spinlock_t *s);
+//     Example:
+//         if (spinlock_trylock(&s)) { ... spinlock_unlock(&s); }
+//
+// void spinlock_unlock(spinlock_t *s);
+//     Example:
+//         spinlock_unlock(&s);
+//
+// void spinlock_destroy(spinlock_t *s);
+//     Example:
+//         spinlock_destroy(&s);
+//
+// Debug mode:
+// ----------------------------------------
+// Defining FLUENT_LIBC_SPINLOCK_DEBUG records the owner and asserts on
+// unlock by a non-owner. On Linux it also asserts that the holder was not
+// put to sleep while holding the lock, by comparing the thread's voluntary
+// context switch count at lock and unlock time. That only approximates
+// "a system call was made": a call that returns without blocking goes
+// unnoticed, and sched_yield() or a page fault on a file mapping counts.
+// It is not implied by FLUENT_LIBC_MUTEX_DEBUG: the library's internal
+// spinlocks (watchdog and profiler registries, hashmap buckets) are held
+// across allocations, which may legitimately fault or block.
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: mutex.h
+// ----------------------------------------
+
+#include "mutex.h"
+
+#ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+#   include <stdio.h>
+#   include <stdlib.h>
+#   ifdef __linux__
+#       include <sys/resource.h>
+        // RUSAGE_THREAD is only declared with _GNU_SOURCE
+#       ifdef RUSAGE_THREAD
+#           define SPINLOCK_RUSAGE_THREAD RUSAGE_THREAD
+#       else
+#           define SPINLOCK_RUSAGE_THREAD 1
+#       endif
+#   endif
+#endif
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Initial upper bound, in pauses, of the randomized backoff.
+ */
+#ifndef SPINLOCK_BACKOFF_MIN
+#   define SPINLOCK_BACKOFF_MIN 4u
+#endif
+
+/**
+ * @brief Cap, in pauses, of the randomized backoff.
+ */
+#ifndef SPINLOCK_BACKOFF_MAX
+#   define SPINLOCK_BACKOFF_MAX 1024u
+#endif
+
+/**
+ * @brief Pauses spent waiting before a waiter starts yielding (0 = never).
+ */
+#ifndef SPINLOCK_YIELD_AFTER
+#   define SPINLOCK_YIELD_AFTER 65536u
+#endif
+
+/**
+ * @brief Busy-waiting lock.
+ *
+ * An all-zero spinlock_t is unlocked; SPINLOCK_INIT may be used for
+ * static initialization.
+ */
+typedef struct {
+    uint32_t locked;        /**< 1 while held */
+#ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+    uintptr_t owner;        /**< Thread id of the holder (debug builds only) */
+    long owner_nvcsw;       /**< Holder's voluntary context switches at lock time */
+#endif
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+#ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+static inline long spinlock_debug_nvcsw(void) {
+#   ifdef __linux__
+    struct rusage usage;
+    if (getrusage(SPINLOCK_RUSAGE_THREAD, &usage) == 0) {
+        return usage.ru_nvcsw;
+    }
+#   endif
+    return 0;
+}
+
+static inline void spinlock_debug_fail(const spinlock_t *s, const char *what) {
+    fprintf(stderr, "spinlock: %s on %p\n", what, (const void *) s);
+    fflush(stderr);
+    abort();
+}
+#endif
+
+/**
+ * @brief Draws the next backoff length from a per-thread xorshift generator.
+ */
+static inline uint32_t spinlock_backoff_random(void) {
+    static FLUENT_LIBC_THREAD_LOCAL uint32_t seed = 0;
+    uint32_t x = seed;
+    if (x == 0) {
+        x = (uint32_t) mutex_thread_id() * 2654435761u | 1u;
+    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seed = x;
+    return x;
+}
+
+/**
+ * @brief Initializes the spinlock.
+ *
+ * @param s Pointer to the spinlock_t structure to initialize.
+ */
+static inline void spinlock_init(spinlock_t *s) {
+    s->locked = 0;
+#   ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+    s->owner = 0;
+    s->owner_nvcsw = 0;
+#   endif
+}
+
+/**
+ * @brief Records the new holder (debug builds only).
+ */
+static inline void spinlock_on_acquired(spinlock_t *s) {
+#   ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+    s->owner = mutex_thread_id();
+    s->owner_nvcsw = spinlock_debug_nvcsw();
+#   else
+    (void) s;
+#   endif
+}
+
+/**
+ * @brief Tries to acquire the spinlock without waiting.
+ *
+ * @param s Pointer to the spinlock_t structure to lock.
+ * @return 1 if the lock was acquired, 0 otherwise.
+ */
+static inline int spinlock_trylock(spinlock_t *s) {
+    // Test before test-and-set so a held lock's cache line stays shared
+    if (__atomic_load_n(&s->locked, __ATOMIC_RELAXED) != 0
+        || __atomic_exchange_n(&s->locked, 1, __ATOMIC_ACQUIRE) != 0) {
+        return 0;
+    }
+
+    spinlock_on_acquired(s);
+    return 1;
+}
+
+/**
+ * @brief Acquires the spinlock, busy-waiting while it is held.
+ *
+ * @param s Pointer to the spinlock_t structure to lock.
+ */
+static inline void spinlock_lock(spinlock_t *s) {
+    if (__atomic_exchange_n(&s->locked, 1, __ATOMIC_ACQUIRE) == 0) {
+        spinlock_on_acquired(s);
+        return;
+    }
+
+    uint32_t backoff = SPINLOCK_BACKOFF_MIN;
+    uint32_t waited = 0;
+    for (;;) {
+        // Wait for the lock to look free without writing to its line
+        while (__atomic_load_n(&s->locked, __ATOMIC_RELAXED) != 0) {
+            if (SPINLOCK_YIELD_AFTER != 0 && waited >= SPINLOCK_YIELD_AFTER) {
+                mutex_thread_yield();
+                continue;
+            }
+            mutex_cpu_relax();
+            waited++;
+        }
+
+        if (__atomic_exchange_n(&s->locked, 1, __ATOMIC_ACQUIRE) == 0) {
+            spinlock_on_acquired(s);
+            return;
+        }
+
+        // Lost the race: back off so the winners' lines are not hammered
+        const uint32_t pauses = spinlock_backoff_random() % backoff;
+        for (uint32_t i = 0; i < pauses; i++) {
+            mutex_cpu_relax();
+        }
+        waited += pauses;
+        if (backoff < SPINLOCK_BACKOFF_MAX) {
+            backoff <<= 1;
+        }
+    }
+}
+
+/**
+ * @brief Releases the spinlock.
+ *
+ * @param s Pointer to the spinlock_t structure to unlock.
+ */
+static inline void spinlock_unlock(spinlock_t *s) {
+#   ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+    if (s->owner != mutex_thread_id()) {
+        spinlock_debug_fail(s, "unlock by non-owner");
+    }
+    if (spinlock_debug_nvcsw() != s->owner_nvcsw) {
+        spinlock_debug_fail(s, "holder slept (blocking system call?) while holding");
+    }
+    s->owner = 0;
+#   endif
+    __atomic_store_n(&s->locked, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Destroys the spinlock.
+ *
+ * A spinlock holds no resources; this exists for symmetry with mutex_t.
+ *
+ * @param s Pointer to the spinlock_t structure to destroy.
+ */
+static inline void spinlock_destroy(spinlock_t *s) {
+#   ifdef FLUENT_LIBC_SPINLOCK_DEBUG
+    if (__atomic_load_n(&s->locked, __ATOMIC_RELAXED) != 0) {
+        spinlock_debug_fail(s, "destroy while locked");
+    }
+#   else
+    (void) s;
+#   endif
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_SPINLOCK_LIBRARY_H
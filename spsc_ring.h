@@ -0,0 +1,347 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_SPSC_RING_LIBRARY_H
+#define FLUENT_LIBC_SPSC_RING_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// spsc_ring_t API
+// ----------------------------------------
+// Single-producer/single-consumer byte ring for variable-length records.
+// Exactly one thread may write and exactly one thread may read. Neither
+// side performs an atomic read-modify-write: each side owns its index
+// and publishes it with a plain release store.
+//
+// - Each side keeps a cached copy of the peer's index and only re-reads
+//   the shared one when the cached value says the ring is full (producer)
+//   or empty (consumer), so the peer's cache line is rarely touched.
+// - Records are written in place: reserve space, fill it, commit. Commits
+//   stay private to the producer until spsc_ring_publish(), so a burst of
+//   records costs a single store on the shared line.
+// - The consumer reads records in place with spsc_ring_peek() and frees
+//   them with spsc_ring_release().
+//
+// A record never wraps around the end of the buffer; when it does not
+// fit in the remaining tail, the producer skips to the start. A record
+// (payload plus 8-byte header) may use at most half the capacity, and
+// its payload must be shorter than UINT32_MAX bytes (the header's
+// length field, which reserves UINT32_MAX as the wrap marker).
+// ----------------------------------------
+// Features:
+// - spsc_ring_init:     Allocate a ring with a byte capacity.
+// - spsc_ring_reserve:  Get contiguous space for one record (producer).
+// - spsc_ring_commit:   Finish the reserved record (producer).
+// - spsc_ring_publish:  Make committed records visible (producer).
+// - spsc_ring_push:     Copy one record in and publish it (producer).
+// - spsc_ring_peek:     Get the next record in place (consumer).
+// - spsc_ring_release:  Free the record returned by peek (consumer).
+// - spsc_ring_destroy:  Release ring memory.
+//
+// Function Signatures:
+// ----------------------------------------
+// int spsc_ring_init(spsc_ring_t *r, size_t capacity);
+//     Example:
+//         spsc_ring_t ring;
+//         spsc_ring_init(&ring, 1 << 20);
+//
+// void *spsc_ring_reserve(spsc_ring_t *r, size_t len);
+//     Example:
+//         char *msg = spsc_ring_reserve(&ring, 256);
+//         if (msg) { size_t n = format(msg, 256); spsc_ring_commit(&ring, n); }
+//
+// int spsc_ring_commit(spsc_ring_t *r, size_t len);
+//     Example:
+//         spsc_ring_commit(&ring, n);
+//
+// void spsc_ring_publish(spsc_ring_t *r);
+//     Example:
+//         spsc_ring_publish(&ring); // once per batch
+//
+// int spsc_ring_push(spsc_ring_t *r, const void *data, size_t len);
+//     Example:
+//         if (!spsc_ring_push(&ring, line, len)) { ... full ... }
+//
+// const void *spsc_ring_peek(spsc_ring_t *r, size_t *len);
+//     Example:
+//         size_t len;
+//         const char *msg;
+//         while ((msg = spsc_ring_peek(&ring, &len))) {
+//             parse(msg, len);
+//             spsc_ring_release(&ring);
+//         }
+//
+// void spsc_ring_release(spsc_ring_t *r);
+//     Example:
+//         spsc_ring_release(&ring);
+//
+// void spsc_ring_destroy(spsc_ring_t *r);
+//     Example:
+//         spsc_ring_destroy(&ring);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: stdlib.h, string.h
+// ----------------------------------------
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Size of the length header in front of every record; also the
+ * record alignment.
+ */
+#define SPSC_RING_HEADER 8u
+
+/**
+ * @brief Header length marking "skip to the start of the buffer".
+ */
+#define SPSC_RING_WRAP UINT32_MAX
+
+/**
+ * @brief State owned by one side, on its own cache line.
+ */
+typedef union {
+    struct {
+        size_t pos;          /**< Private position (unpublished for the producer) */
+        size_t cached_peer;  /**< Last seen value of the peer's shared index */
+        size_t reserved;     /**< Producer: header plus payload bytes of the open reservation, 0 if none */
+    } s;
+    char pad[64];
+} spsc_ring_side_t;
+
+/**
+ * @brief Shared index, on its own cache line.
+ */
+typedef union {
+    size_t pos;
+    char pad[64];
+} spsc_ring_index_t;
+
+/**
+ * @brief Single-producer/single-consumer byte ring.
+ */
+typedef struct {
+    spsc_ring_side_t producer;  /**< Written only by the producer */
+    spsc_ring_index_t head;     /**< Published write position */
+    spsc_ring_index_t tail;     /**< Published read position */
+    spsc_ring_side_t consumer;  /**< Written only by the consumer */
+    unsigned char *buf;         /**< capacity bytes */
+    size_t mask;                /**< capacity - 1 */
+} spsc_ring_t;
+
+/**
+ * @brief Bytes a record with a payload of len bytes occupies.
+ */
+static inline size_t spsc_ring_record_size(const size_t len) {
+    return SPSC_RING_HEADER + ((len + SPSC_RING_HEADER - 1) & ~(size_t) (SPSC_RING_HEADER - 1));
+}
+
+/**
+ * @brief Initializes the ring.
+ *
+ * @param r Pointer to the spsc_ring_t structure to initialize.
+ * @param capacity Minimum size in bytes; rounded up to a power of two.
+ * @return 0 on success, EINVAL for a capacity below two headers, ENOMEM on allocation failure.
+ */
+static inline int spsc_ring_init(spsc_ring_t *r, const size_t capacity) {
+    if (capacity < 2 * SPSC_RING_HEADER || capacity > ((size_t) -1 >> 1)) {
+        return EINVAL;
+    }
+
+    size_t cap = 2 * SPSC_RING_HEADER;
+    while (cap < capacity) {
+        cap <<= 1;
+    }
+
+    r->buf = (unsigned char *) malloc(cap);
+    if (!r->buf) {
+        return ENOMEM;
+    }
+    r->mask = cap - 1;
+    r->head.pos = 0;
+    r->tail.pos = 0;
+    r->producer.s.pos = 0;
+    r->producer.s.cached_peer = 0;
+    r->producer.s.reserved = 0;
+    r->consumer.s.pos = 0;
+    r->consumer.s.cached_peer = 0;
+    r->consumer.s.reserved = 0;
+    return 0;
+}
+
+/**
+ * @brief Reserves contiguous space for one record of up to len bytes.
+ *
+ * Producer only. The space stays invisible to the consumer until
+ * spsc_ring_commit() and spsc_ring_publish(). Reserving again without
+ * committing discards the previous reservation.
+ *
+ * @param r Pointer to the spsc_ring_t structure.
+ * @param len Maximum payload size.
+ * @return Pointer to len writable bytes (8-byte aligned), or NULL if the ring is
+ *         full, the record is larger than half the capacity, or len is
+ *         UINT32_MAX or more.
+ */
+static inline void *spsc_ring_reserve(spsc_ring_t *r, const size_t len) {
+    // The header holds the length in 32 bits, UINT32_MAX meaning "wrap"
+    if (len >= SPSC_RING_WRAP) {
+        return NULL;
+    }
+    const size_t cap = r->mask + 1;
+    const size_t total = spsc_ring_record_size(len);
+    // Capping records at half the ring keeps a wrapped record satisfiable
+    if (total > cap / 2) {
+        return NULL;
+    }
+
+    const size_t pos = r->producer.s.pos;
+    const size_t off = pos & r->mask;
+    const size_t contiguous = cap - off;
+    // A record that does not fit before the end also burns the tail bytes
+    const size_t need = total <= contiguous ? total : contiguous + total;
+
+    if (cap - (pos - r->producer.s.cached_peer) < need) {
+        r->producer.s.cached_peer = __atomic_load_n(&r->tail.pos, __ATOMIC_ACQUIRE);
+        if (cap - (pos - r->producer.s.cached_peer) < need) {
+            return NULL;
+        }
+    }
+
+    if (total > contiguous) {
+        *(uint32_t *) (r->buf + off) = SPSC_RING_WRAP;
+        r->producer.s.pos = pos + contiguous;
+    }
+    r->producer.s.reserved = SPSC_RING_HEADER + len;
+    return r->buf + (r->producer.s.pos & r->mask) + SPSC_RING_HEADER;
+}
+
+/**
+ * @brief Finishes the reserved record with its final length.
+ *
+ * Producer only. The record becomes visible at the next spsc_ring_publish().
+ *
+ * @param r Pointer to the spsc_ring_t structure.
+ * @param len Payload size; at most the reserved length.
+ * @return 0 on success, or EINVAL if nothing is reserved or len exceeds
+ *         the reservation. On EINVAL nothing is committed and a
+ *         reservation, if any, stays in place.
+ */
+static inline int spsc_ring_commit(spsc_ring_t *r, const size_t len) {
+    if (r->producer.s.reserved == 0 || len > r->producer.s.reserved - SPSC_RING_HEADER) {
+        return EINVAL;
+    }
+    const size_t total = spsc_ring_record_size(len);
+    *(uint32_t *) (r->buf + (r->producer.s.pos & r->mask)) = (uint32_t) len;
+    r->producer.s.pos += total;
+    r->producer.s.reserved = 0;
+    return 0;
+}
+
+/**
+ * @brief Makes every committed record visible to the consumer.
+ *
+ * Producer only. One release store, however many records were committed.
+ *
+ * @param r Pointer to the spsc_ring_t structure.
+ */
+static inline void spsc_ring_publish(spsc_ring_t *r) {
+    __atomic_store_n(&r->head.pos, r->producer.s.pos, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Copies one record into the ring and publishes it.
+ *
+ * Producer only.
+ *
+ * @param r Pointer to the spsc_ring_t structure.
+ * @param data Payload.
+ * @param len Payload size.
+ * @return 1 if the record was pushed, 0 if the ring is full.
+ */
+static inline int spsc_ring_push(spsc_ring_t *r, const void *data, const size_t len) {
+    void *dst = spsc_ring_reserve(r, len);
+    if (!dst) {
+        return 0;
+    }
+    memcpy(dst, data, len);
+    spsc_ring_commit(r, len);
+    spsc_ring_publish(r);
+    return 1;
+}
+
+/**
+ * @brief Returns the next published record without consuming it.
+ *
+ * Consumer only. The pointer stays valid until spsc_ring_release().
+ *
+ * @param r Pointer to the spsc_ring_t structure.
+ * @param len Receives the payload size.
+ * @return Pointer to the payload, or NULL if the ring is empty.
+ */
+static inline const void *spsc_ring_peek(spsc_ring_t *r, size_t *len) {
+    for (;;) {
+        const size_t pos = r->consumer.s.pos;
+        if (pos == r->consumer.s.cached_peer) {
+            r->consumer.s.cached_peer = __atomic_load_n(&r->head.pos, __ATOMIC_ACQUIRE);
+            if (pos == r->consumer.s.cached_peer) {
+                return NULL;
+            }
+        }
+
+        const size_t off = pos & r->mask;
+        const uint32_t header = *(const uint32_t *) (r->buf + off);
+        if (header == SPSC_RING_WRAP) {
+            r->consumer.s.pos = pos + (r->mask + 1 - off);
+            continue;
+        }
+        *len = header;
+        return r->buf + off + SPSC_RING_HEADER;
+    }
+}
+
+/**
+ * @brief Frees the record last returned by spsc_ring_peek().
+ *
+ * Consumer only.
+ *
+ * @param r Pointer to the spsc_ring_t structure.
+ */
+static inline void spsc_ring_release(spsc_ring_t *r) {
+    const size_t pos = r->consumer.s.pos;
+    const uint32_t header = *(const uint32_t *) (r->buf + (pos & r->mask));
+    r->consumer.s.pos = pos + spsc_ring_record_size(header);
+    __atomic_store_n(&r->tail.pos, r->consumer.s.pos, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Destroys the ring.
+ *
+ * @param r Pointer to the spsc_ring_t structure to destroy.
+ */
+static inline void spsc_ring_destroy(spsc_ring_t *r) {
+    free(r->buf);
+    r->buf = NULL;
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_SPSC_RING_LIBRARY_H
@@ -0,0 +1,213 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+// mutex_t tests: mutual exclusion under each handoff policy, FIFO
+// handoff order, zero-filled mutexes and recursive re-entry.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../mutex.h"
+
+#define THREADS 4
+#define ITERATIONS 50000
+#define FIFO_WAITERS 6
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void sleep_ms(const long ms) {
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// ============= MUTUAL EXCLUSION =============
+typedef struct {
+    mutex_t *m;
+    volatile uint64_t counter;  // Plain increments; only the mutex protects them
+    volatile int inside;        // Threads inside the critical section
+    int overlaps;
+} exclusion_t;
+
+static void *exclusion_worker(void *arg) {
+    exclusion_t *x = (exclusion_t *) arg;
+    for (int i = 0; i < ITERATIONS; i++) {
+        mutex_lock(x->m);
+        if (x->inside++ != 0) {
+            x->overlaps++;
+        }
+        x->counter++;
+        x->inside--;
+        mutex_unlock(x->m);
+    }
+    return NULL;
+}
+
+static void check_exclusion(mutex_t *m) {
+    exclusion_t x;
+    memset(&x, 0, sizeof(x));
+    x.m = m;
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, exclusion_worker, &x);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    CHECK(x.counter == (uint64_t) THREADS * ITERATIONS);
+    CHECK(x.overlaps == 0);
+    CHECK(m->state == 0);
+    CHECK(mutex_owner(m) == 0);
+}
+
+static void test_exclusion(const mutex_handoff_t handoff) {
+    mutex_attr_t attr;
+    mutex_attr_init(&attr);
+    attr.handoff = handoff;
+    mutex_t m;
+    mutex_init_ex(&m, &attr);
+    check_exclusion(&m);
+    mutex_destroy(&m);
+}
+
+// ============= FIFO HANDOFF =============
+typedef struct {
+    mutex_t m;
+    int order[FIFO_WAITERS];
+    int next;
+    volatile int started;
+} fifo_t;
+
+typedef struct {
+    fifo_t *f;
+    int index;
+} fifo_arg_t;
+
+static void *fifo_waiter(void *arg) {
+    const fifo_arg_t *a = (const fifo_arg_t *) arg;
+    __atomic_store_n(&a->f->started, a->index + 1, __ATOMIC_RELEASE);
+    mutex_lock(&a->f->m);
+    a->f->order[a->f->next++] = a->index;
+    mutex_unlock(&a->f->m);
+    return NULL;
+}
+
+static void test_fifo_order(void) {
+    static fifo_t f;
+    memset(&f, 0, sizeof(f));
+    mutex_attr_t attr;
+    mutex_attr_init(&attr);
+    attr.handoff = MUTEX_HANDOFF_FIFO;
+    mutex_init_ex(&f.m, &attr);
+
+    mutex_lock(&f.m);
+    pthread_t threads[FIFO_WAITERS];
+    fifo_arg_t args[FIFO_WAITERS];
+    for (int i = 0; i < FIFO_WAITERS; i++) {
+        args[i].f = &f;
+        args[i].index = i;
+        pthread_create(&threads[i], NULL, fifo_waiter, &args[i]);
+        while (__atomic_load_n(&f.started, __ATOMIC_ACQUIRE) != i + 1) {
+            sleep_ms(1);
+        }
+        // Long enough for the waiter to give up spinning and park
+        sleep_ms(50);
+    }
+    CHECK(f.m.state & MUTEX_STATE_PARKED);
+    mutex_unlock(&f.m);
+
+    for (int i = 0; i < FIFO_WAITERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(f.next == FIFO_WAITERS);
+    for (int i = 0; i < FIFO_WAITERS; i++) {
+        CHECK(f.order[i] == i);
+    }
+    mutex_destroy(&f.m);
+}
+
+// ============= ZERO-FILLED MUTEX =============
+static void test_zero_filled(void) {
+    static mutex_t zero_static;
+    mutex_t m;
+    memset(&m, 0, sizeof(m));
+
+    CHECK(!mutex_is_locked_by_me(&m));
+    mutex_lock(&m);
+    CHECK(mutex_is_locked_by_me(&m));
+    CHECK(mutex_owner(&m) == mutex_thread_id());
+    mutex_unlock(&m);
+    CHECK(!mutex_is_locked_by_me(&m));
+
+    check_exclusion(&m);
+    check_exclusion(&zero_static);
+}
+
+// ============= RECURSIVE RE-ENTRY =============
+static void *recursive_other(void *arg) {
+    mutex_t *m = (mutex_t *) arg;
+    CHECK(!mutex_is_locked_by_me(m));
+    mutex_lock(m);
+    mutex_unlock(m);
+    return NULL;
+}
+
+static void test_recursive(void) {
+    mutex_attr_t attr;
+    mutex_attr_init(&attr);
+    attr.kind = MUTEX_RECURSIVE;
+    mutex_t m;
+    mutex_init_ex(&m, &attr);
+
+    mutex_lock(&m);
+    mutex_lock(&m);
+    mutex_lock(&m);
+    CHECK(m.recursion == 2);
+    mutex_unlock(&m);
+    mutex_unlock(&m);
+    CHECK(mutex_is_locked_by_me(&m));
+    mutex_unlock(&m);
+    CHECK(!mutex_is_locked_by_me(&m));
+    CHECK(m.state == 0);
+
+    // Released for real: another thread can take it
+    pthread_t other;
+    pthread_create(&other, NULL, recursive_other, &m);
+    pthread_join(other, NULL);
+
+    check_exclusion(&m);
+    mutex_destroy(&m);
+}
+
+int main(void) {
+    test_exclusion(MUTEX_HANDOFF_BARGING);
+    test_exclusion(MUTEX_HANDOFF_FIFO);
+    test_exclusion(MUTEX_HANDOFF_EVENTUAL);
+    test_fifo_order();
+    test_zero_filled();
+    test_recursive();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("mutex_test: all checks passed\n");
+    return 0;
+}
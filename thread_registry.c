@@ -0,0 +1,83 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "thread_registry.h"
+
+#ifdef _WIN32
+#   include <malloc.h>
+#endif
+
+#define THREAD_REGISTRY_LINE 64
+
+// Links are accessed through memcpy: their declared types differ per record
+static void *link_get(const void *record, const size_t offset) {
+    void *value;
+    memcpy(&value, (const char *) record + offset, sizeof(value));
+    return value;
+}
+
+static void link_set(void *record, const size_t offset, void *value) {
+    memcpy((char *) record + offset, &value, sizeof(value));
+}
+
+/**
+ * @brief Zero-filled, cache-line-aligned memory for one record; never freed.
+ */
+static void *record_alloc(const size_t size) {
+    const size_t bytes = (size + THREAD_REGISTRY_LINE - 1) & ~(size_t) (THREAD_REGISTRY_LINE - 1);
+#ifdef _WIN32
+    void *p = _aligned_malloc(bytes, THREAD_REGISTRY_LINE);
+#else
+    void *p = NULL;
+    if (posix_memalign(&p, THREAD_REGISTRY_LINE, bytes) != 0) {
+        p = NULL;
+    }
+#endif
+    if (p) {
+        memset(p, 0, bytes);
+    }
+    return p;
+}
+
+void *thread_registry_take(thread_registry_t *reg) {
+    spinlock_lock(&reg->guard);
+    void *self = reg->free_list;
+    if (self) {
+        reg->free_list = link_get(self, reg->next_free_offset);
+    }
+    spinlock_unlock(&reg->guard);
+
+    if (!self) {
+        self = record_alloc(reg->size);
+        if (!self) {
+            // Readers have no way to report failure; once per thread
+            fprintf(stderr, "%s: out of memory registering a thread\n", reg->name);
+            abort();
+        }
+        __atomic_add_fetch(&reg->count, 1, __ATOMIC_RELAXED);
+        void *head = __atomic_load_n(&reg->head, __ATOMIC_RELAXED);
+        do {
+            link_set(self, reg->next_offset, head);
+        } while (!__atomic_compare_exchange_n(&reg->head, &head, self, 1,
+                                              __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+    link_set(self, reg->next_free_offset, NULL);
+    return self;
+}
+
+void thread_registry_give_back(thread_registry_t *reg, void *record) {
+    spinlock_lock(&reg->guard);
+    link_set(record, reg->next_free_offset, reg->free_list);
+    reg->free_list = record;
+    spinlock_unlock(&reg->guard);
+}
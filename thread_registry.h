@@ -0,0 +1,108 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_THREAD_REGISTRY_LIBRARY_H
+#define FLUENT_LIBC_THREAD_REGISTRY_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// thread_registry_t API
+// ----------------------------------------
+// Registry of per-thread records for the reclamation schemes (ebr,
+// hazard pointers, rcu). Each record is a caller-defined type with two
+// link fields: one chaining every record ever created, and one for the
+// list of records recycled from exited threads.
+//
+// - The registry list is push-only and records are never freed, so
+//   scanners walk it with an acquire load of the head and no lock.
+// - New records are zero-filled and start on a 64-byte boundary, and
+//   their size is rounded up to whole cache lines, so fields that the
+//   owner writes on every read-side entry share no line with
+//   neighbouring allocations.
+// - Allocation failure aborts: readers have no way to report it, and
+//   it happens at most once per thread.
+// ----------------------------------------
+// Features:
+// - THREAD_REGISTRY_INIT:       Static initializer for a record type.
+// - thread_registry_take:       Recycled record, or a new registered one.
+// - thread_registry_give_back:  Recycle the record of an exiting thread.
+//
+// Function Signatures:
+// ----------------------------------------
+// void *thread_registry_take(thread_registry_t *reg);
+// void thread_registry_give_back(thread_registry_t *reg, void *record);
+//     Example:
+//         static thread_registry_t registry =
+//             THREAD_REGISTRY_INIT(ebr_record_t, r.next, r.next_free, "ebr");
+//         ebr_record_t *self = (ebr_record_t *) thread_registry_take(&registry);
+//         ...
+//         thread_registry_give_back(&registry, self); // at thread exit
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: spinlock.h
+// ----------------------------------------
+
+#include <stddef.h>
+#include "spinlock.h"
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Every record of one type, and the recycled ones.
+ */
+typedef struct {
+    void *head;                /**< Newest record; push-only */
+    size_t count;              /**< Records ever created */
+    spinlock_t guard;          /**< Guards free_list */
+    void *free_list;           /**< Records of exited threads */
+    size_t size;               /**< sizeof the record type */
+    size_t next_offset;        /**< offsetof the registry link */
+    size_t next_free_offset;   /**< offsetof the recycled-list link */
+    const char *name;          /**< Prefix of the out-of-memory message */
+} thread_registry_t;
+
+/**
+ * @brief Initializer for a registry of `type` records linked through the
+ * `next` and `next_free` members.
+ */
+#define THREAD_REGISTRY_INIT(type, next, next_free, name) \
+    { NULL, 0, SPINLOCK_INIT, NULL, sizeof(type), offsetof(type, next), offsetof(type, next_free), (name) }
+
+/**
+ * @brief Returns a recycled record, or a new zero-filled one pushed on
+ * the registry. Aborts when out of memory.
+ *
+ * A recycled record keeps whatever its last owner left in it, except
+ * that its recycled-list link is cleared.
+ *
+ * @param reg The registry.
+ * @return The record, 64-byte aligned.
+ */
+void *thread_registry_take(thread_registry_t *reg);
+
+/**
+ * @brief Puts a record on the recycled list for the next thread. The
+ * record stays on the registry.
+ *
+ * @param reg The registry.
+ * @param record A record returned by thread_registry_take().
+ */
+void thread_registry_give_back(thread_registry_t *reg, void *record);
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_THREAD_REGISTRY_LIBRARY_H
@@ -0,0 +1,185 @@
+/*
+ * This code is distributed under the terms of the GNU General Public License.
+ * For more information, please refer to the LICENSE file in the root directory.
+ * -------------------------------------------------
+ * Copyright (C) 2025 Rodrigo R.
+ * This program comes with ABSOLUTELY NO WARRANTY; for details type show w'.
+ * This is free software, and you are welcome to redistribute it
+ * under certain conditions; type show c' for details.
+*/
+
+#ifndef FLUENT_LIBC_WAIT_LIBRARY_H
+#define FLUENT_LIBC_WAIT_LIBRARY_H
+
+// ============= FLUENT LIB C =============
+// wait_on_address API
+// ----------------------------------------
+// Portable wait-on-address (futex / WaitOnAddress / atomic::wait style)
+// for arbitrary 32-bit words. A thread sleeps while a word still holds
+// an expected value; another thread changes the word and wakes it.
+// This lets callers build custom synchronization on their own state
+// words (e.g. a ring buffer's empty/full flags) without a mutex_t.
+//
+// On Linux the calls go straight to the futex system call; elsewhere
+// they use the library's parking lot. Wake-ups may be spurious, so
+// waiters always re-check their condition in a loop.
+// ----------------------------------------
+// Features:
+// - wait_on_address:  Sleep while *addr == expected, with an optional timeout.
+// - wake_one:         Wake one thread waiting on addr.
+// - wake_all:         Wake every thread waiting on addr.
+// - wake_n:           Wake up to n threads waiting on addr.
+//
+// Function Signatures:
+// ----------------------------------------
+// int wait_on_address(const uint32_t *addr, uint32_t expected, uint64_t timeout_ns);
+//     Example:
+//         uint32_t v;
+//         while ((v = __atomic_load_n(&ring->full, __ATOMIC_ACQUIRE)) != 0)
+//             wait_on_address(&ring->full, v, WAIT_FOREVER);
+//
+// void wake_one(const uint32_t *addr);
+//     Example:
+//         __atomic_store_n(&ring->full, 0, __ATOMIC_RELEASE);
+//         wake_one(&ring->full);
+//
+// void wake_all(const uint32_t *addr);
+//     Example:
+//         wake_all(&ring->full);
+//
+// void wake_n(const uint32_t *addr, uint32_t count);
+//     Example:
+//         wake_n(&sem->permits, released);
+//
+// ----------------------------------------
+// Initial revision: 2025-05-26
+// ----------------------------------------
+// Depends on: linux/futex.h (Linux), parking_lot.h (elsewhere), mutex.h
+// ----------------------------------------
+
+#include <errno.h>
+#include <limits.h>
+#include "parking_lot.h"
+#include "mutex.h"
+
+#ifdef __linux__
+#   include <unistd.h>
+#   include <sys/syscall.h>
+#   include <linux/futex.h>
+#endif
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * @brief Timeout value meaning "wait until woken".
+ */
+#define WAIT_FOREVER PARKING_LOT_FOREVER
+
+/**
+ * @brief Count for wake_n() meaning "every waiter".
+ */
+#define WAIT_ALL UINT32_MAX
+
+#ifndef __linux__
+/**
+ * @brief Park condition for the parking-lot fallback.
+ */
+typedef struct {
+    const uint32_t *addr;
+    uint32_t expected;
+} wait_on_address_ctx_t;
+
+static inline int wait_on_address_still_expected(void *ctx) {
+    const wait_on_address_ctx_t *w = (const wait_on_address_ctx_t *) ctx;
+    return __atomic_load_n(w->addr, __ATOMIC_SEQ_CST) == w->expected;
+}
+#endif
+
+/**
+ * @brief Sleeps while `*addr == expected`.
+ *
+ * @param addr Word to wait on.
+ * @param expected Value that keeps the caller asleep.
+ * @param timeout_ns Relative timeout, or WAIT_FOREVER.
+ * @return 0 after a wake-up (possibly spurious), EAGAIN if the word did
+ *         not hold `expected`, ETIMEDOUT if the timeout elapsed.
+ */
+static inline int wait_on_address(const uint32_t *addr, const uint32_t expected, const uint64_t timeout_ns) {
+#   ifdef __linux__
+    struct timespec ts;
+    struct timespec *tsp = NULL;
+    if (timeout_ns != WAIT_FOREVER) {
+        ts.tv_sec = (time_t) (timeout_ns / 1000000000ULL);
+        ts.tv_nsec = (long) (timeout_ns % 1000000000ULL);
+        tsp = &ts;
+    }
+
+    // Owner-aware mutex spinners must not wait for a sleeping owner
+    mutex_thread_blocking_begin();
+    const long rc = syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, tsp, NULL, 0);
+    const int err = rc == 0 ? 0 : errno;
+    mutex_thread_blocking_end();
+
+    return err == EAGAIN || err == ETIMEDOUT ? err : 0;
+#   else
+    wait_on_address_ctx_t ctx = { addr, expected };
+    switch (parking_lot_park(addr, wait_on_address_still_expected, NULL, &ctx, timeout_ns, NULL)) {
+        case PARKING_LOT_INVALID:
+            return EAGAIN;
+        case PARKING_LOT_TIMED_OUT:
+            return ETIMEDOUT;
+        default:
+            return 0;
+    }
+#   endif
+}
+
+/**
+ * @brief Wakes up to `count` threads waiting on `addr`.
+ *
+ * @param addr Word the threads wait on.
+ * @param count Maximum number of threads to wake.
+ */
+static inline void wake_n(const uint32_t *addr, const uint32_t count) {
+#   ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count > (uint32_t) INT_MAX ? INT_MAX : (int) count, NULL, NULL, 0);
+#   else
+    if (count == WAIT_ALL) {
+        parking_lot_unpark_all(addr, 0);
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (!parking_lot_unpark_one(addr, NULL, NULL).unparked_thread) {
+            return;
+        }
+    }
+#   endif
+}
+
+/**
+ * @brief Wakes one thread waiting on `addr`.
+ *
+ * @param addr Word the thread waits on.
+ */
+static inline void wake_one(const uint32_t *addr) {
+    wake_n(addr, 1);
+}
+
+/**
+ * @brief Wakes every thread waiting on `addr`.
+ *
+ * @param addr Word the threads wait on.
+ */
+static inline void wake_all(const uint32_t *addr) {
+    wake_n(addr, WAIT_ALL);
+}
+
+// ============= FLUENT LIB C++ =============
+#if defined(__cplusplus)
+}
+#endif
+
+#endif //FLUENT_LIBC_WAIT_LIBRARY_H